@@ -9,6 +9,8 @@ Description: Implementation of chess engine interface
 #include <iostream>
 #include <string.h>
 #include <sys/wait.h>
+#include <signal.h>
+#include <sys/select.h>
 
 // destructor and pipeline
 ECE_ChessEngine::~ECE_ChessEngine() {
@@ -38,6 +40,30 @@ std::string ECE_ChessEngine::ReadFromEngine() {
     return output;
 }
 
+/**
+ * check the engine's pipe without blocking
+ * @return true if output is waiting to be read, or the pipe was closed
+ */
+bool ECE_ChessEngine::outputPending() {
+    fd_set readfds;
+    struct timeval tv;
+    FD_ZERO(&readfds);
+    FD_SET(outPipe[0], &readfds);
+    tv.tv_sec = 0;
+    tv.tv_usec = 0;
+    return select(outPipe[0] + 1, &readfds, NULL, NULL, &tv) > 0;
+}
+
+// the engine closed its output (exited or crashed): reap it and stop offering its pipe
+void ECE_ChessEngine::engineLost() {
+    close(inPipe[1]);
+    close(outPipe[0]);
+    kill(enginePid, SIGKILL);
+    waitpid(enginePid, NULL, 0);
+    isRunning = false;
+    std::cout << "Chess engine exited" << std::endl;
+}
+
 /**
  * pipeline to communicate with the chess engine
  * @return true if engine is initialized
@@ -71,11 +97,22 @@ bool ECE_ChessEngine::InitializeEngine() {
     close(inPipe[0]);
     close(outPipe[1]);
 
+    // a missing engine must not kill us through SIGPIPE on the first write
+    signal(SIGPIPE, SIG_IGN);
+
     // uci mode
     SendToEngine("uci");
     std::string response;
     while (response.find("uciok") == std::string::npos) {
-        response = ReadFromEngine();
+        std::string chunk = ReadFromEngine();
+        if (chunk.empty()) {
+            // pipe closed, the engine could not be started
+            close(inPipe[1]);
+            close(outPipe[0]);
+            waitpid(enginePid, NULL, 0);
+            return false;
+        }
+        response += chunk;
     }
 
     SendToEngine("isready");
@@ -92,8 +129,21 @@ bool ECE_ChessEngine::InitializeEngine() {
  */
 bool ECE_ChessEngine::sendMove(const std::string& strMove) {
     if (!isRunning) return false;
-    
-    SendToEngine("position startpos moves " + strMove);
+
+    // output nobody waited for (late info lines, readyok) must not be read as this reply
+    while (outputPending()) {
+        if (ReadFromEngine().empty()) {
+            engineLost();
+            return false;
+        }
+    }
+    moveHistory.push_back(strMove);
+    pendingOutput.clear();
+    std::string position = "position startpos moves";
+    for (const auto& move : moveHistory) {
+        position += " " + move;
+    }
+    SendToEngine(position);
     SendToEngine("go depth 10");
     return true;
 }
@@ -106,15 +156,73 @@ bool ECE_ChessEngine::sendMove(const std::string& strMove) {
 bool ECE_ChessEngine::getResponseMove(std::string& strMove) {
     if (!isRunning) return false;
 
-    std::string response;
-    while ((response = ReadFromEngine()).find("bestmove") == std::string::npos) {
-        // Keep reading until we get bestmove
+    // Keep reading until we get bestmove
+    while (!parseBestMove(strMove)) {
+        std::string chunk = ReadFromEngine();
+        if (chunk.empty()) return false;
+        pendingOutput += chunk;
     }
-    
-    size_t pos = response.find("bestmove");
-    if (pos != std::string::npos) {
-        strMove = response.substr(pos + 9, 4);
-        return true;
+    if (strMove == "(none)") return false;
+    moveHistory.push_back(strMove);
+    return true;
+}
+
+/**
+ * check for the best move without blocking
+ * @param strMove string of the move, empty if the engine had none
+ * @return true once the engine has answered
+ */
+bool ECE_ChessEngine::pollResponseMove(std::string& strMove) {
+    if (!isRunning) return false;
+
+    // read whatever is waiting on the pipe
+    if (outputPending()) {
+        std::string chunk = ReadFromEngine();
+        if (chunk.empty()) {
+            // engine went away, answer with no move
+            engineLost();
+            strMove.clear();
+            return true;
+        }
+        pendingOutput += chunk;
     }
-    return false;
+
+    if (!parseBestMove(strMove)) return false;
+    // "bestmove (none)" when there is no legal move
+    if (strMove == "(none)") {
+        strMove.clear();
+    } else {
+        moveHistory.push_back(strMove);
+    }
+    return true;
+}
+
+/**
+ * take a complete bestmove line out of the output read so far
+ * @param strMove string of the move
+ * @return true if a full line was found
+ */
+bool ECE_ChessEngine::parseBestMove(std::string& strMove) {
+    size_t pos = pendingOutput.find("bestmove");
+    if (pos == std::string::npos) return false;
+    size_t lineEnd = pendingOutput.find('\n', pos);
+    if (lineEnd == std::string::npos) return false;
+
+    // 4 characters, or 5 for a promotion
+    size_t end = pendingOutput.find_first_of(" \r\n", pos + 9);
+    strMove = pendingOutput.substr(pos + 9, end - pos - 9);
+    pendingOutput.erase(0, lineEnd + 1);
+    return true;
+}
+
+/**
+ * take back moves. The engine is stateless between "position" commands, so
+ * trimming the move list is enough; the next search resends the shorter game.
+ * @param plies number of half moves to drop
+ * @return true if that many moves were played
+ */
+bool ECE_ChessEngine::takeback(unsigned int plies) {
+    if (!isRunning || plies > moveHistory.size()) return false;
+    moveHistory.resize(moveHistory.size() - plies);
+    return true;
 }
\ No newline at end of file
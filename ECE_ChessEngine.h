@@ -9,27 +9,43 @@ Description: Interface class for communicating with the Komodo chess engine usin
 #define ECE_CHESS_ENGINE_H
 
 #include <string>
+#include <vector>
 #include <unistd.h>
+#include "ECE_EngineInterface.h"
 
 // manage communication with the chess engine
-class ECE_ChessEngine {
+class ECE_ChessEngine : public ECE_EngineInterface {
 private:
     int inPipe[2];
     int outPipe[2];
     pid_t enginePid;
     bool isRunning;
+    std::vector<std::string> moveHistory;   // moves of the current game, sent with every search
+    std::string pendingOutput;              // engine output not yet consumed
 
 public:
     ECE_ChessEngine() : isRunning(false) {}
     ~ECE_ChessEngine();
 
-    bool InitializeEngine();
-    bool sendMove(const std::string& strMove);
-    bool getResponseMove(std::string& strMove);
+    bool InitializeEngine() override;
+    bool sendMove(const std::string& strMove) override;
+    bool getResponseMove(std::string& strMove) override;
+    bool pollResponseMove(std::string& strMove) override;
+    bool takeback(unsigned int plies) override;
+    int getResponseFd() const override { return isRunning ? outPipe[0] : -1; }
+    // resynchronise with a game played elsewhere, e.g. after switching engines
+    bool setMoveHistory(const std::vector<std::string>& moves) override {
+        moveHistory = moves;
+        return isRunning;
+    }
     
 private:
     void SendToEngine(const std::string& command);
     std::string ReadFromEngine();
+    bool outputPending();
+    void engineLost();
+    // take a complete "bestmove" line out of the pending output
+    bool parseBestMove(std::string& strMove);
 };
 
 #endif
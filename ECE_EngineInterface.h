@@ -0,0 +1,34 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Common interface for the chess engines the game can play against
+(the external Komodo process and the built-in search engine)
+*/
+
+#ifndef ECE_ENGINE_INTERFACE_H
+#define ECE_ENGINE_INTERFACE_H
+
+#include <string>
+#include <vector>
+
+class ECE_EngineInterface {
+public:
+    virtual ~ECE_EngineInterface() {}
+
+    virtual bool InitializeEngine() = 0;
+    virtual bool sendMove(const std::string& strMove) = 0;
+    virtual bool getResponseMove(std::string& strMove) = 0;
+    // non-blocking check for the reply to sendMove; true once the engine has answered,
+    // with strMove left empty if it had no move to play
+    virtual bool pollResponseMove(std::string& strMove) = 0;
+    // drop the last plies from the engine's game without restarting it
+    virtual bool takeback(unsigned int plies) = 0;
+    // replace the engine's game with moves played from the starting position, e.g. after
+    // switching engines mid-game; false if the engine could not follow them
+    virtual bool setMoveHistory(const std::vector<std::string>& moves) = 0;
+    // file descriptor that becomes readable when a reply arrives, -1 if there is none
+    virtual int getResponseFd() const { return -1; }
+};
+
+#endif
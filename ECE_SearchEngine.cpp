@@ -0,0 +1,580 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Implementation of the built-in multi-threaded alpha-beta engine
+*/
+
+#include "ECE_SearchEngine.h"
+#include "chess_tables.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+const int INF = 32000;
+const int MATE = 31000;
+const int MATE_BOUND = MATE - 1000;   // scores beyond this are mates
+const int MAX_PLY = 96;
+
+enum { BOUND_UPPER = 1, BOUND_LOWER = 2, BOUND_EXACT = 3 };
+
+// packed transposition table data: move | score << 16 | depth << 32 | bound << 40
+uint64_t packTT(moveT move, int score, int depth, int bound) {
+    return static_cast<uint64_t>(move) |
+           (static_cast<uint64_t>(static_cast<uint16_t>(static_cast<int16_t>(score))) << 16) |
+           (static_cast<uint64_t>(depth & 0xFF) << 32) |
+           (static_cast<uint64_t>(bound) << 40);
+}
+moveT ttMove(uint64_t d) { return static_cast<moveT>(d & 0xFFFF); }
+int ttScore(uint64_t d) { return static_cast<int16_t>((d >> 16) & 0xFFFF); }
+int ttDepth(uint64_t d) { return static_cast<int>((d >> 32) & 0xFF); }
+int ttBound(uint64_t d) { return static_cast<int>((d >> 40) & 3); }
+
+// mate scores are stored relative to the node, not the root
+int scoreToTT(int score, int ply) {
+    if (score > MATE_BOUND) return score + ply;
+    if (score < -MATE_BOUND) return score - ply;
+    return score;
+}
+int scoreFromTT(int score, int ply) {
+    if (score > MATE_BOUND) return score - ply;
+    if (score < -MATE_BOUND) return score + ply;
+    return score;
+}
+
+const int PIECE_VALUE[7] = {0, 100, 320, 330, 500, 900, 0};
+
+// piece-square tables from white's point of view, a1 first
+const int PST[7][64] = {
+    {0},
+    {  0,  0,  0,  0,  0,  0,  0,  0,   5, 10, 10,-20,-20, 10, 10,  5,
+       5, -5,-10,  0,  0,-10, -5,  5,   0,  0,  0, 20, 20,  0,  0,  0,
+       5,  5, 10, 25, 25, 10,  5,  5,  10, 10, 20, 30, 30, 20, 10, 10,
+      50, 50, 50, 50, 50, 50, 50, 50,   0,  0,  0,  0,  0,  0,  0,  0},
+    {-50,-40,-30,-30,-30,-30,-40,-50, -40,-20,  0,  5,  5,  0,-20,-40,
+     -30,  5, 10, 15, 15, 10,  5,-30, -30,  0, 15, 20, 20, 15,  0,-30,
+     -30,  5, 15, 20, 20, 15,  5,-30, -30,  0, 10, 15, 15, 10,  0,-30,
+     -40,-20,  0,  0,  0,  0,-20,-40, -50,-40,-30,-30,-30,-30,-40,-50},
+    {-20,-10,-10,-10,-10,-10,-10,-20, -10,  5,  0,  0,  0,  0,  5,-10,
+     -10, 10, 10, 10, 10, 10, 10,-10, -10,  0, 10, 10, 10, 10,  0,-10,
+     -10,  5,  5, 10, 10,  5,  5,-10, -10,  0,  5, 10, 10,  5,  0,-10,
+     -10,  0,  0,  0,  0,  0,  0,-10, -20,-10,-10,-10,-10,-10,-10,-20},
+    {  0,  0,  0,  5,  5,  0,  0,  0,  -5,  0,  0,  0,  0,  0,  0, -5,
+      -5,  0,  0,  0,  0,  0,  0, -5,  -5,  0,  0,  0,  0,  0,  0, -5,
+      -5,  0,  0,  0,  0,  0,  0, -5,  -5,  0,  0,  0,  0,  0,  0, -5,
+       5, 10, 10, 10, 10, 10, 10,  5,   0,  0,  0,  0,  0,  0,  0,  0},
+    {-20,-10,-10, -5, -5,-10,-10,-20, -10,  0,  5,  0,  0,  0,  0,-10,
+     -10,  5,  5,  5,  5,  5,  0,-10,   0,  0,  5,  5,  5,  5,  0, -5,
+      -5,  0,  5,  5,  5,  5,  0, -5, -10,  0,  5,  5,  5,  5,  0,-10,
+     -10,  0,  0,  0,  0,  0,  0,-10, -20,-10,-10, -5, -5,-10,-10,-20},
+    { 20, 30, 10,  0,  0, 10, 30, 20,  20, 20,  0,  0,  0,  0, 20, 20,
+     -10,-20,-20,-20,-20,-20,-20,-10, -20,-30,-30,-40,-40,-30,-30,-20,
+     -30,-40,-40,-50,-50,-40,-40,-30, -30,-40,-40,-50,-50,-40,-40,-30,
+     -30,-40,-40,-50,-50,-40,-40,-30, -30,-40,-40,-50,-50,-40,-40,-30}
+};
+
+// material and placement, from the side to move
+int evaluate(const ChessBoard& b) {
+    int score = 0;
+    for (int type = PAWN; type <= KING; type++) {
+        uint64_t w = b.pieces(type);
+        while (w) score += PIECE_VALUE[type] + PST[type][popLsb(w)];
+        uint64_t k = b.pieces(type | BLACK_BIT);
+        while (k) score -= PIECE_VALUE[type] + PST[type][popLsb(k) ^ 56];
+    }
+    return b.isWhiteToMove() ? score : -score;
+}
+
+typedef std::chrono::steady_clock clockT;
+
+double secondsSince(clockT::time_point start) {
+    return std::chrono::duration<double>(clockT::now() - start).count();
+}
+
+// per-thread search state for Lazy SMP
+struct searchWorker {
+    ChessBoard board;
+    TranspositionTable& tt;
+    std::atomic<bool>& stop;
+    const searchLimitsT& limits;
+    clockT::time_point start;
+    unsigned int id;
+    uint64_t nodes;
+    moveT killers[MAX_PLY][2];
+    int historyScore[16][64];
+    std::vector<uint64_t> hashStack;   // every position before the current one
+    moveT rootBest;
+
+    // result of the last completed iteration
+    moveT bestMove;
+    int bestScore;
+    int completedDepth;
+    std::vector<double> depthTimes;
+
+    searchWorker(const ChessBoard& root, const std::vector<uint64_t>& history, TranspositionTable& table,
+                 std::atomic<bool>& stopFlag, const searchLimitsT& searchLimits, clockT::time_point t0,
+                 unsigned int threadId)
+        : board(root), tt(table), stop(stopFlag), limits(searchLimits), start(t0), id(threadId), nodes(0),
+          hashStack(history), rootBest(NULL_MOVE), bestMove(NULL_MOVE), bestScore(0), completedDepth(0) {
+        memset(killers, 0, sizeof(killers));
+        memset(historyScore, 0, sizeof(historyScore));
+        hashStack.reserve(history.size() + MAX_PLY + 1);
+    }
+
+    // only the main thread watches the clock
+    void checkTime() {
+        if (id == 0 && limits.moveTimeMs > 0 && (nodes & 2047) == 0 &&
+            secondsSince(start) * 1000.0 >= limits.moveTimeMs) {
+            stop = true;
+        }
+    }
+
+    bool isRepetition() const {
+        int limit = std::min<int>(board.getHalfmoveClock(), static_cast<int>(hashStack.size()));
+        for (int i = 2; i <= limit; i += 2) {
+            if (hashStack[hashStack.size() - i] == board.getHash()) return true;
+        }
+        return false;
+    }
+
+    // move ordering score
+    int orderScore(moveT m, moveT hashMove, int ply) const {
+        if (m == hashMove) return 1000000;
+        int victim = board.pieceAt(moveTo(m));
+        int attacker = board.pieceAt(moveFrom(m));
+        if (victim != PIECE_NONE) return 100000 + PIECE_VALUE[pieceType(victim)] * 10 - pieceType(attacker);
+        if (movePromo(m)) return 95000 + movePromo(m);
+        if (m == killers[ply][0]) return 90000;
+        if (m == killers[ply][1]) return 89000;
+        return historyScore[attacker][moveTo(m)];
+    }
+
+    // bring the best remaining move to position i
+    static void pickMove(moveT* moves, int* scores, int count, int i) {
+        int best = i;
+        for (int j = i + 1; j < count; j++) {
+            if (scores[j] > scores[best]) best = j;
+        }
+        std::swap(moves[i], moves[best]);
+        std::swap(scores[i], scores[best]);
+    }
+
+    int quiesce(int alpha, int beta, int ply) {
+        nodes++;
+        checkTime();
+        if (stop) return 0;
+
+        int standPat = evaluate(board);
+        if (ply >= MAX_PLY - 1) return standPat;
+        if (standPat >= beta) return standPat;
+        if (standPat > alpha) alpha = standPat;
+
+        moveT moves[MAX_MOVES];
+        int scores[MAX_MOVES];
+        int count = board.generateMoves(moves, true);
+        for (int i = 0; i < count; i++) scores[i] = orderScore(moves[i], NULL_MOVE, ply);
+
+        int best = standPat;
+        undoT undo;
+        for (int i = 0; i < count; i++) {
+            pickMove(moves, scores, count, i);
+            if (!board.makeMove(moves[i], undo)) continue;
+            int score = -quiesce(-beta, -alpha, ply + 1);
+            board.unmakeMove(undo);
+            if (stop) return 0;
+            if (score > best) {
+                best = score;
+                if (score > alpha) {
+                    alpha = score;
+                    if (score >= beta) break;
+                }
+            }
+        }
+        return best;
+    }
+
+    int pvs(int depth, int alpha, int beta, int ply, bool allowNull) {
+        bool pvNode = (beta - alpha) > 1;
+        if (ply > 0 && (board.getHalfmoveClock() >= 100 || isRepetition())) return 0;
+
+        bool inCheck = board.inCheck();
+        if (inCheck) depth++;
+        if (depth <= 0) return quiesce(alpha, beta, ply);
+        if (ply >= MAX_PLY - 1) return evaluate(board);
+
+        nodes++;
+        checkTime();
+        if (stop) return 0;
+
+        // transposition table
+        uint64_t ttData;
+        moveT hashMove = NULL_MOVE;
+        if (tt.probe(board.getHash(), ttData)) {
+            hashMove = ttMove(ttData);
+            int ttS = scoreFromTT(ttScore(ttData), ply);
+            if (!pvNode && ply > 0 && ttDepth(ttData) >= depth) {
+                int bound = ttBound(ttData);
+                if (bound == BOUND_EXACT ||
+                    (bound == BOUND_LOWER && ttS >= beta) ||
+                    (bound == BOUND_UPPER && ttS <= alpha)) {
+                    return ttS;
+                }
+            }
+        }
+
+        // null move pruning, skipped when only pawns are left (zugzwang)
+        int us = board.isWhiteToMove() ? 0 : BLACK_BIT;
+        uint64_t bigPieces = board.pieces(KNIGHT | us) | board.pieces(BISHOP | us) |
+                             board.pieces(ROOK | us) | board.pieces(QUEEN | us);
+        if (!pvNode && !inCheck && allowNull && depth >= 3 && bigPieces && evaluate(board) >= beta) {
+            undoT nullUndo;
+            hashStack.push_back(board.getHash());
+            board.makeNullMove(nullUndo);
+            int score = -pvs(depth - 3, -beta, -beta + 1, ply + 1, false);
+            board.unmakeNullMove(nullUndo);
+            hashStack.pop_back();
+            if (stop) return 0;
+            if (score >= beta) return score >= MATE_BOUND ? beta : score;
+        }
+
+        moveT moves[MAX_MOVES];
+        int scores[MAX_MOVES];
+        int count = board.generateMoves(moves);
+        for (int i = 0; i < count; i++) scores[i] = orderScore(moves[i], hashMove, ply);
+
+        int originalAlpha = alpha;
+        int best = -INF;
+        moveT bestMoveHere = NULL_MOVE;
+        int legal = 0;
+        undoT undo;
+        for (int i = 0; i < count; i++) {
+            pickMove(moves, scores, count, i);
+            moveT m = moves[i];
+            bool quiet = board.pieceAt(moveTo(m)) == PIECE_NONE && !movePromo(m);
+            uint64_t hashBefore = board.getHash();
+            if (!board.makeMove(m, undo)) continue;
+            legal++;
+            hashStack.push_back(hashBefore);
+
+            int score;
+            if (legal == 1) {
+                score = -pvs(depth - 1, -beta, -alpha, ply + 1, true);
+            } else {
+                // late move reduction for quiet moves, then a null window probe
+                int reduction = (depth >= 3 && legal > 4 && quiet && !inCheck) ? 1 : 0;
+                score = -pvs(depth - 1 - reduction, -alpha - 1, -alpha, ply + 1, true);
+                if (score > alpha && (reduction || score < beta)) {
+                    score = -pvs(depth - 1, -beta, -alpha, ply + 1, true);
+                }
+            }
+
+            hashStack.pop_back();
+            board.unmakeMove(undo);
+            if (stop) return 0;
+
+            if (score > best) {
+                best = score;
+                bestMoveHere = m;
+                if (ply == 0) rootBest = m;
+                if (score > alpha) {
+                    alpha = score;
+                    if (score >= beta) {
+                        if (quiet) {
+                            if (killers[ply][0] != m) {
+                                killers[ply][1] = killers[ply][0];
+                                killers[ply][0] = m;
+                            }
+                            int& h = historyScore[board.pieceAt(moveFrom(m))][moveTo(m)];
+                            h = std::min(h + depth * depth, 80000);
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (legal == 0) return inCheck ? -MATE + ply : 0;
+
+        int bound = best >= beta ? BOUND_LOWER : (best > originalAlpha ? BOUND_EXACT : BOUND_UPPER);
+        tt.store(board.getHash(), packTT(bestMoveHere, scoreToTT(best, ply), depth, bound));
+        return best;
+    }
+
+    // iterative deepening; helper threads are offset by one ply to diversify the shared table
+    void run() {
+        int maxDepth = limits.maxDepth > 0 ? std::min(limits.maxDepth, MAX_PLY - 1) : MAX_PLY - 1;
+        for (int depth = 1; depth <= maxDepth && !stop; depth++) {
+            int searchDepth = (id > 0 && depth > 1) ? std::min(depth + static_cast<int>(id & 1), maxDepth) : depth;
+            rootBest = NULL_MOVE;
+            int score = pvs(searchDepth, -INF, INF, 0, false);
+            if (stop && id != 0) break;
+            if (stop) {
+                // keep a partial iteration only if it already found a move
+                if (rootBest != NULL_MOVE && completedDepth > 0) bestMove = rootBest;
+                break;
+            }
+            bestMove = rootBest;
+            bestScore = score;
+            completedDepth = searchDepth;
+            depthTimes.push_back(secondsSince(start));
+        }
+        // the main thread ends the search for everybody
+        if (id == 0) stop = true;
+    }
+};
+
+}
+
+// Transposition table management
+void TranspositionTable::resize(size_t megabytes) {
+    size_t count = 1;
+    while (count * 2 * sizeof(ttEntryT) <= megabytes * 1024 * 1024) count *= 2;
+    entries.reset(new ttEntryT[count]);
+    mask = count - 1;
+    clear();
+}
+
+void TranspositionTable::clear() {
+    for (uint64_t i = 0; entries && i <= mask; i++) {
+        entries[i].key.store(0, std::memory_order_relaxed);
+        entries[i].data.store(0, std::memory_order_relaxed);
+    }
+}
+
+bool TranspositionTable::probe(uint64_t hash, uint64_t& data) const {
+    if (!entries) return false;
+    const ttEntryT& e = entries[hash & mask];
+    uint64_t key = e.key.load(std::memory_order_relaxed);
+    data = e.data.load(std::memory_order_relaxed);
+    return (key ^ data) == hash && data != 0;
+}
+
+void TranspositionTable::store(uint64_t hash, uint64_t data) {
+    if (!entries) return;
+    ttEntryT& e = entries[hash & mask];
+    e.key.store(hash ^ data, std::memory_order_relaxed);
+    e.data.store(data, std::memory_order_relaxed);
+}
+
+ECE_SearchEngine::ECE_SearchEngine() : stopFlag(false), searchDone(false), isRunning(false), hintSearch(false) {
+    limits.maxDepth = 6;
+    limits.moveTimeMs = 2000;
+    limits.threads = std::max(1u, std::thread::hardware_concurrency());
+    lastResult.bestMove = NULL_MOVE;
+}
+
+ECE_SearchEngine::~ECE_SearchEngine() {
+    waitForSearch();
+}
+
+/**
+ * set up the hash table and the starting position
+ * @return true if engine is initialized
+ */
+bool ECE_SearchEngine::InitializeEngine() {
+    tt.resize(64);
+    board.reset();
+    gameHashes.clear();
+    gameUndo.clear();
+    isRunning = true;
+    return true;
+}
+
+void ECE_SearchEngine::applyGameMove(moveT move) {
+    gameHashes.push_back(board.getHash());
+    gameUndo.emplace_back();
+    board.makeMove(move, gameUndo.back());
+}
+
+// abort a background search that nobody will collect
+void ECE_SearchEngine::waitForSearch() {
+    if (searchThread.joinable()) {
+        stopFlag = true;
+        searchThread.join();
+    }
+    hintSearch = false;
+}
+
+/**
+ * apply the opponent's move and start the reply search
+ * @param strMove string of the move
+ * @return true if the move is legal
+ */
+bool ECE_SearchEngine::sendMove(const std::string& strMove) {
+    if (!isRunning) return false;
+    waitForSearch();
+    moveT move = ChessBoard::parseUciMove(strMove);
+    if (move == NULL_MOVE || !board.isLegalMove(move)) return false;
+    applyGameMove(move);
+
+    stopFlag = false;
+    searchDone = false;
+    searchThread = std::thread([this]() {
+        runSearch(board, gameHashes, lastResult);
+        searchDone = true;
+    });
+    return true;
+}
+
+/**
+ * wait for the best move and play it
+ * @param strMove string of the move
+ * @return true if a move was found (false when the game is over)
+ */
+bool ECE_SearchEngine::getResponseMove(std::string& strMove) {
+    if (!isRunning || hintSearch || !searchThread.joinable()) return false;
+    searchThread.join();
+    if (lastResult.bestMove == NULL_MOVE) return false;
+    applyGameMove(lastResult.bestMove);
+    strMove = ChessBoard::moveToUci(lastResult.bestMove);
+    return true;
+}
+
+/**
+ * play the best move if the background search has finished
+ * @param strMove string of the move, empty if there was none
+ * @return true once the search has finished
+ */
+bool ECE_SearchEngine::pollResponseMove(std::string& strMove) {
+    if (!isRunning || hintSearch || !searchThread.joinable() || !searchDone) return false;
+    strMove.clear();
+    getResponseMove(strMove);
+    return true;
+}
+
+/**
+ * start searching a hint in the background, the same way as a reply
+ * @param root position to search
+ * @param history hashes of the game positions before root, for repetition detection
+ * @return true if the search started
+ */
+bool ECE_SearchEngine::startHint(const ChessBoard& root, const std::vector<uint64_t>& history) {
+    if (!isRunning) return false;
+    waitForSearch();
+    hintRoot = root;
+    hintHistory = history;
+    hintSearch = true;
+    stopFlag = false;
+    searchDone = false;
+    searchThread = std::thread([this]() {
+        runSearch(hintRoot, hintHistory, hintResult);
+        searchDone = true;
+    });
+    return true;
+}
+
+/**
+ * collect the hint if its search has finished
+ * @param strMove string of the move, empty if there was none
+ * @return true once the search has finished
+ */
+bool ECE_SearchEngine::pollHint(std::string& strMove) {
+    if (!hintSearch || !searchDone) return false;
+    searchThread.join();
+    hintSearch = false;
+    strMove.clear();
+    if (hintResult.bestMove != NULL_MOVE) strMove = ChessBoard::moveToUci(hintResult.bestMove);
+    return true;
+}
+
+/**
+ * take back moves on the engine's board
+ * @param plies number of half moves to undo
+ * @return true if that many moves were played
+ */
+bool ECE_SearchEngine::takeback(unsigned int plies) {
+    if (!isRunning || plies > gameUndo.size()) return false;
+    waitForSearch();
+    for (unsigned int i = 0; i < plies; i++) {
+        board.unmakeMove(gameUndo.back());
+        gameUndo.pop_back();
+        gameHashes.pop_back();
+    }
+    return true;
+}
+
+/**
+ * replace the engine's game, keeping the undo records so takeback still works
+ * @param moves moves from the starting position in uci notation
+ * @return true if every move was legal
+ */
+bool ECE_SearchEngine::setMoveHistory(const std::vector<std::string>& moves) {
+    waitForSearch();
+    board.reset();
+    gameHashes.clear();
+    gameUndo.clear();
+    for (const std::string& strMove : moves) {
+        moveT move = ChessBoard::parseUciMove(strMove);
+        if (move == NULL_MOVE || !board.isLegalMove(move)) return false;
+        applyGameMove(move);
+    }
+    return true;
+}
+
+/**
+ * strength level to search limits
+ * @param level 1 (weakest) .. 20
+ */
+void ECE_SearchEngine::setStrength(int level) {
+    level = std::max(1, std::min(level, 20));
+    limits.maxDepth = level;
+    limits.moveTimeMs = 250 * level;
+}
+
+/**
+ * blocking search of a position, see runSearch
+ * @param root position to search
+ * @param history hashes of the game positions before root, for repetition detection
+ * @param result best move, score, node count and time-to-depth
+ * @return true if a move was found
+ */
+bool ECE_SearchEngine::search(const ChessBoard& root, const std::vector<uint64_t>& history,
+                              searchResultT& result) {
+    if (!isRunning) return false;
+    stopFlag = false;
+    return runSearch(root, history, result);
+}
+
+/**
+ * Lazy SMP search: every thread runs its own iterative deepening over a private board,
+ * sharing only the transposition table. The main thread's result is reported.
+ * @param root position to search
+ * @param history hashes of the game positions before root, for repetition detection
+ * @param result best move, score, node count and time-to-depth
+ * @return true if a move was found
+ */
+bool ECE_SearchEngine::runSearch(const ChessBoard& root, const std::vector<uint64_t>& history,
+                                 searchResultT& result) {
+    clockT::time_point start = clockT::now();
+    unsigned int numThreads = std::max(1u, limits.threads);
+
+    std::vector<std::unique_ptr<searchWorker>> workers;
+    for (unsigned int i = 0; i < numThreads; i++) {
+        workers.emplace_back(new searchWorker(root, history, tt, stopFlag, limits, start, i));
+    }
+    std::vector<std::thread> helpers;
+    for (unsigned int i = 1; i < numThreads; i++) {
+        helpers.emplace_back(&searchWorker::run, workers[i].get());
+    }
+    workers[0]->run();
+    for (auto& h : helpers) h.join();
+
+    result.bestMove = workers[0]->bestMove;
+    result.score = workers[0]->bestScore;
+    result.depth = workers[0]->completedDepth;
+    result.depthTimes = workers[0]->depthTimes;
+    result.nodes = 0;
+    for (auto& w : workers) result.nodes += w->nodes;
+    result.seconds = secondsSince(start);
+
+    // fall back to any legal move if not even depth 1 finished
+    if (result.bestMove == NULL_MOVE) {
+        ChessBoard copy = root;
+        moveT moves[MAX_MOVES];
+        if (copy.generateLegalMoves(moves) > 0) result.bestMove = moves[0];
+    }
+    return result.bestMove != NULL_MOVE;
+}
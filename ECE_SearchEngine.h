@@ -0,0 +1,116 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Built-in chess engine. Iterative deepening principal variation search over
+the shared ChessBoard, with a lock-free transposition table shared by Lazy SMP helper
+threads. Used for low strength levels, hints, and when Komodo cannot be started.
+*/
+
+#ifndef ECE_SEARCH_ENGINE_H
+#define ECE_SEARCH_ENGINE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ECE_EngineInterface.h"
+#include "chess_board.h"
+
+// Transposition table entry. The key is stored xor'ed with the data so a torn
+// write from another thread is detected as a miss instead of needing a lock.
+struct ttEntryT {
+    std::atomic<uint64_t> key;
+    std::atomic<uint64_t> data;
+};
+
+class TranspositionTable {
+private:
+    std::unique_ptr<ttEntryT[]> entries;
+    uint64_t mask;
+
+public:
+    TranspositionTable() : mask(0) {}
+
+    void resize(size_t megabytes);
+    void clear();
+    bool probe(uint64_t hash, uint64_t& data) const;
+    void store(uint64_t hash, uint64_t data);
+};
+
+// search limits, 0 means no limit
+struct searchLimitsT {
+    int maxDepth;
+    int moveTimeMs;
+    unsigned int threads;
+};
+
+struct searchResultT {
+    moveT bestMove;
+    int score;                        // centipawns from the side to move
+    int depth;                        // last fully completed iteration
+    uint64_t nodes;                   // summed over all threads
+    double seconds;
+    std::vector<double> depthTimes;   // time at which each depth completed
+};
+
+class ECE_SearchEngine : public ECE_EngineInterface {
+private:
+    ChessBoard board;
+    std::vector<uint64_t> gameHashes;   // positions before the current one
+    std::vector<undoT> gameUndo;        // undo record for every game move
+    TranspositionTable tt;
+    searchLimitsT limits;
+    std::atomic<bool> stopFlag;
+    std::atomic<bool> searchDone;       // background search has finished
+    std::thread searchThread;
+    searchResultT lastResult;
+    bool isRunning;
+    // the background search is a hint, which is reported and never played
+    bool hintSearch;
+    ChessBoard hintRoot;
+    std::vector<uint64_t> hintHistory;
+    searchResultT hintResult;
+
+    void applyGameMove(moveT move);
+    void waitForSearch();
+    // the search itself; stopFlag is left as the caller set it, so a stop issued
+    // before a background search gets going is not lost
+    bool runSearch(const ChessBoard& root, const std::vector<uint64_t>& history, searchResultT& result);
+
+public:
+    ECE_SearchEngine();
+    ~ECE_SearchEngine();
+
+    bool InitializeEngine() override;
+    // applies the opponent move and starts searching the reply in the background
+    bool sendMove(const std::string& strMove) override;
+    // waits for the background search and plays its move
+    bool getResponseMove(std::string& strMove) override;
+    // plays the move once the background search has finished, without waiting
+    bool pollResponseMove(std::string& strMove) override;
+    // unmakes the last plies on the engine's own board
+    bool takeback(unsigned int plies) override;
+
+    // replay the game's moves from the starting position, e.g. when switching engines mid-game
+    bool setMoveHistory(const std::vector<std::string>& moves) override;
+    // 1 (weakest) .. 20, maps to a depth limit
+    void setStrength(int level);
+    void setLimits(const searchLimitsT& newLimits) { limits = newLimits; }
+    void setHashSize(size_t megabytes) { tt.resize(megabytes); }
+
+    // search a game position for a hint in the background, like a reply but not played
+    bool startHint(const ChessBoard& root, const std::vector<uint64_t>& history);
+    // the hint once its search has finished, strMove empty if there is no legal move
+    bool pollHint(std::string& strMove);
+    bool isHintRunning() const { return hintSearch; }
+
+    // blocking search of an arbitrary position, used for benchmarking
+    bool search(const ChessBoard& root, const std::vector<uint64_t>& history, searchResultT& result);
+    void stop() { stopFlag = true; }
+    void clearHash() { tt.clear(); }
+};
+
+#endif
@@ -0,0 +1,165 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Implementation of the fixed-capacity animation pool
+*/
+
+#include "animation_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+float ease(int curve, float t) {
+    switch (curve) {
+        case EASE_IN_OUT: return t * t * (3.0f - 2.0f * t);
+        case EASE_OUT:    { float u = 1.0f - t; return 1.0f - u * u * u; }
+        default:          return t;
+    }
+}
+
+}
+
+AnimationPool::AnimationPool(unsigned int maxAnimations)
+    : capacity(std::min(maxAnimations, 65535u)), activeCount(0), freeCount(0),
+      clock(0.0), nextExpiry(std::numeric_limits<double>::max()) {
+    // everything is sized here so running animations never allocates
+    fromPos.resize(capacity);
+    toPos.resize(capacity);
+    startTime.resize(capacity);
+    duration.resize(capacity);
+    arcHeight.resize(capacity);
+    target.resize(capacity);
+    generation.assign(capacity, 1);
+    kind.resize(capacity);
+    curve.resize(capacity);
+    activeSlots.resize(capacity);
+    activeIndex.resize(capacity);
+    freeSlots.resize(capacity);
+
+    // hand out low slots first
+    for (unsigned int i = 0; i < capacity; i++) {
+        freeSlots[freeCount++] = static_cast<uint16_t>(capacity - 1 - i);
+    }
+}
+
+int AnimationPool::slotOf(animHandleT handle) const {
+    unsigned int slot = handle & 0xFFFF;
+    if (handle == NO_ANIM || slot >= capacity) return -1;
+    if (generation[slot] != (handle >> 16)) return -1;
+    return static_cast<int>(slot);
+}
+
+animHandleT AnimationPool::allocate(uint16_t targetId, uint8_t animKind, float time, float wait) {
+    if (freeCount == 0) return NO_ANIM;
+    uint16_t slot = freeSlots[--freeCount];
+    target[slot] = targetId;
+    kind[slot] = animKind;
+    startTime[slot] = clock + wait;
+    duration[slot] = std::max(time, 1e-4f);
+    nextExpiry = std::min(nextExpiry, startTime[slot] + duration[slot]);
+    arcHeight[slot] = 0.0f;
+    curve[slot] = EASE_LINEAR;
+    activeIndex[slot] = static_cast<uint16_t>(activeCount);
+    activeSlots[activeCount++] = slot;
+    return slot | (static_cast<animHandleT>(generation[slot]) << 16);
+}
+
+void AnimationPool::release(uint16_t slot) {
+    // swap the last running slot into the hole
+    uint16_t index = activeIndex[slot];
+    uint16_t last = activeSlots[--activeCount];
+    activeSlots[index] = last;
+    activeIndex[last] = index;
+
+    // a new generation invalidates every outstanding handle to this slot
+    if (++generation[slot] == 0) generation[slot] = 1;
+    freeSlots[freeCount++] = slot;
+}
+
+animHandleT AnimationPool::startMove(uint16_t targetId, const glm::vec3& from, const glm::vec3& to,
+                                     float time, int easing, float hop, float wait) {
+    animHandleT handle = allocate(targetId, ANIM_MOVE, time, wait);
+    if (handle == NO_ANIM) return NO_ANIM;
+    uint16_t slot = handle & 0xFFFF;
+    fromPos[slot] = from;
+    toPos[slot] = to;
+    arcHeight[slot] = hop;
+    curve[slot] = static_cast<uint8_t>(easing);
+    return handle;
+}
+
+animHandleT AnimationPool::startFade(uint16_t targetId, float fromAlpha, float toAlpha, float time, float wait) {
+    animHandleT handle = allocate(targetId, ANIM_FADE, time, wait);
+    if (handle == NO_ANIM) return NO_ANIM;
+    uint16_t slot = handle & 0xFFFF;
+    fromPos[slot] = glm::vec3(fromAlpha, 0.0f, 0.0f);
+    toPos[slot] = glm::vec3(toAlpha, 0.0f, 0.0f);
+    return handle;
+}
+
+bool AnimationPool::retarget(animHandleT handle, const glm::vec3& from, const glm::vec3& to) {
+    int slot = slotOf(handle);
+    if (slot < 0 || kind[slot] != ANIM_MOVE) return false;
+    fromPos[slot] = from;
+    toPos[slot] = to;
+    startTime[slot] = clock;
+    return true;
+}
+
+glm::vec3 AnimationPool::evaluate(uint16_t slot, double t) const {
+    float u = static_cast<float>(std::min(std::max((t - startTime[slot]) / duration[slot], 0.0), 1.0));
+    float e = ease(curve[slot], u);
+    glm::vec3 value = fromPos[slot] + (toPos[slot] - fromPos[slot]) * e;
+    if (kind[slot] == ANIM_MOVE) {
+        // hops follow a sine arc over the raw time so the apex stays centred
+        value.z += arcHeight[slot] * std::sin(u * 3.14159265f);
+    }
+    return value;
+}
+
+bool AnimationPool::sampleMove(animHandleT handle, glm::vec3& position) const {
+    int slot = slotOf(handle);
+    if (slot < 0 || kind[slot] != ANIM_MOVE) return false;
+    position = evaluate(static_cast<uint16_t>(slot), clock);
+    return true;
+}
+
+bool AnimationPool::sampleFade(animHandleT handle, float& alpha) const {
+    int slot = slotOf(handle);
+    if (slot < 0 || kind[slot] != ANIM_FADE) return false;
+    alpha = evaluate(static_cast<uint16_t>(slot), clock).x;
+    return true;
+}
+
+void AnimationPool::cancel(animHandleT handle) {
+    int slot = slotOf(handle);
+    if (slot >= 0) release(static_cast<uint16_t>(slot));
+}
+
+void AnimationPool::update(float deltaTime, glm::vec3* positions, float* alpha) {
+    clock += deltaTime;
+    if (clock < nextExpiry) return;
+
+    // something has ended, settle it and find the next end time
+    nextExpiry = std::numeric_limits<double>::max();
+    unsigned int i = 0;
+    while (i < activeCount) {
+        uint16_t slot = activeSlots[i];
+        double end = startTime[slot] + duration[slot];
+        if (clock < end) {
+            nextExpiry = std::min(nextExpiry, end);
+            i++;
+            continue;
+        }
+        if (kind[slot] == ANIM_MOVE) {
+            positions[target[slot]] = toPos[slot];
+        } else {
+            alpha[target[slot]] = toPos[slot].x;
+        }
+        // the last running slot moves into position i, so do not advance
+        release(slot);
+    }
+}
@@ -0,0 +1,109 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Fixed-capacity pool of piece animations. Storage is allocated once, the
+animations are kept as parallel arrays and addressed through generational handles, so a
+stale handle to a finished animation can never touch the one that reused its slot.
+In-flight values are evaluated on the GPU; the pool only keeps the clock, samples an
+animation on demand and settles the final values when it ends.
+*/
+
+#ifndef ANIMATION_POOL_H
+#define ANIMATION_POOL_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// slot index in the low 16 bits, slot generation in the high 16 bits
+typedef uint32_t animHandleT;
+const animHandleT NO_ANIM = 0;
+
+// easing curves, evaluated on the normalised animation time
+enum {
+    EASE_LINEAR = 0,
+    EASE_IN_OUT,       // smoothstep
+    EASE_OUT           // cubic, fast start and soft landing
+};
+
+enum {
+    ANIM_MOVE = 0,     // slides a position, optionally hopping along an arc
+    ANIM_FADE          // changes an alpha value
+};
+
+class AnimationPool {
+private:
+    unsigned int capacity;
+
+    // one entry per slot
+    std::vector<glm::vec3> fromPos;
+    std::vector<glm::vec3> toPos;
+    std::vector<double> startTime;  // on the pool clock
+    std::vector<float> duration;
+    std::vector<float> arcHeight;   // peak height of a hop, 0 for a slide
+    std::vector<uint16_t> target;   // index into the caller's position/alpha arrays
+    std::vector<uint16_t> generation;
+    std::vector<uint8_t> kind;
+    std::vector<uint8_t> curve;
+
+    // dense list of running slots, and each slot's place in it
+    std::vector<uint16_t> activeSlots;
+    std::vector<uint16_t> activeIndex;
+    unsigned int activeCount;
+
+    // free slots, used as a stack
+    std::vector<uint16_t> freeSlots;
+    unsigned int freeCount;
+
+    // double so the fixed steps still add up exactly after hours of play; the shader
+    // gets it narrowed to float
+    double clock;
+    double nextExpiry;              // earliest end time of a running animation
+
+    animHandleT allocate(uint16_t targetId, uint8_t animKind, float time, float wait);
+    void release(uint16_t slot);
+    int slotOf(animHandleT handle) const;
+    // value of a slot at time t, position for moves and alpha in x for fades
+    glm::vec3 evaluate(uint16_t slot, double t) const;
+
+public:
+    // capacity is fixed for the lifetime of the pool (at most 65535)
+    explicit AnimationPool(unsigned int maxAnimations = 4096);
+
+    /**
+     * start moving a target between two positions
+     * @return handle of the animation, NO_ANIM if the pool is full
+     */
+    animHandleT startMove(uint16_t targetId, const glm::vec3& from, const glm::vec3& to,
+                          float time, int easing, float hop = 0.0f, float wait = 0.0f);
+    /**
+     * start fading a target's alpha
+     * @return handle of the animation, NO_ANIM if the pool is full
+     */
+    animHandleT startFade(uint16_t targetId, float fromAlpha, float toAlpha, float time, float wait = 0.0f);
+
+    // restart a running move from a new position towards a new destination
+    bool retarget(animHandleT handle, const glm::vec3& from, const glm::vec3& to);
+    // current value of a running animation, false if it has finished
+    bool sampleMove(animHandleT handle, glm::vec3& position) const;
+    bool sampleFade(animHandleT handle, float& alpha) const;
+    // stop an animation where it is
+    void cancel(animHandleT handle);
+    bool isActive(animHandleT handle) const { return slotOf(handle) >= 0; }
+
+    /**
+     * advance the clock and settle the animations that have ended. Frames where
+     * nothing ends cost the same however many animations are running.
+     * @param deltaTime elapsed time in seconds
+     * @param positions position of every target, final value written by moves
+     * @param alpha alpha of every target, final value written by fades
+     */
+    void update(float deltaTime, glm::vec3* positions, float* alpha);
+
+    double getClock() const { return clock; }
+    unsigned int activeAnimations() const { return activeCount; }
+    unsigned int getCapacity() const { return capacity; }
+};
+
+#endif
@@ -7,6 +7,8 @@ Game of Chess common file
 #ifndef COMMON_H
 #define COMMON_H
 
+#include <cstdint>
+#include <string>
 #include <unordered_map>
 // Include GLM
 #include <glm/glm.hpp>
@@ -37,14 +39,75 @@ typedef struct
 } tPosition;
 
 // Chess board scaling
-const float CBSCALE = 0.6f;
+constexpr float CBSCALE = 0.6f;
 // Chess board square box size (per side)
 //const float CHESS_BOX_SIZE = 3.f;
-const float CHESS_BOX_SIZE = (float)(CBSCALE * 5.4);
+constexpr float CHESS_BOX_SIZE = (float)(CBSCALE * 5.4);
 // Chess pieces scaling
-const float CPSCALE = 0.015f;
+constexpr float CPSCALE = 0.015f;
 // Platform height
-const float PHEIGHT = -3.0f;
+constexpr float PHEIGHT = -3.0f;
+
+// World position of the centre of each board square (a1 = 0, h8 = 63)
+typedef struct
+{
+    float x;
+    float y;
+    float z;
+} squarePosT;
+
+struct squareTableT
+{
+    squarePosT pos[64];
+
+    constexpr squareTableT() : pos()
+    {
+        for (int sq = 0; sq < 64; sq++)
+        {
+            pos[sq].x = ((sq & 7) - 3.5f) * CHESS_BOX_SIZE;
+            pos[sq].y = ((sq >> 3) - 3.5f) * CHESS_BOX_SIZE;
+            pos[sq].z = PHEIGHT;
+        }
+    }
+};
+
+// Generated at compile time, looked up instead of recomputed per square
+inline constexpr squareTableT SQUARE_POSITIONS;
+
+// Interleaved vertex as stored in a mesh's vertex buffer (attributes 0-2)
+typedef struct
+{
+    glm::vec3 position;
+    glm::vec2 uv;
+    glm::vec3 normal;
+} packedVertexT;
+
+// Quantised vertex, 16 bytes instead of 32 (same attributes 0-2, see GeometryArena)
+typedef struct
+{
+    uint16_t position[4];   // unorm16 xyz inside the mesh's bounding box, w padding
+    uint16_t uv[2];         // half floats
+    int16_t normal[2];      // snorm16 octahedral, decoded in the vertex shader
+} quantisedVertexT;
+
+// Per-instance data of an instanced draw, one entry per copy of a mesh.
+// Laid out to match vertex attributes 3-14 of StandardShading.vertexshader
+typedef struct
+{
+    glm::vec4 motionFrom;     // xyz start position, w start time
+    glm::vec4 motionTo;       // xyz end position, w duration
+    glm::vec4 motionParams;   // easing, hop height, fade start (or alpha), fade duration
+    glm::mat4 model;
+    glm::mat4 mvp;            // VP * model, computed on the CPU in batches
+    glm::vec4 material;       // x texture array (-1 while it streams in), y layer, zw unused
+} instanceDataT;
+
+// Texture arrays the scene's textures are packed into, one sampler each (see TextureArraySet)
+constexpr int MAX_TEXTURE_ARRAYS = 4;
+
+// Levels of detail per mesh, the full mesh included
+constexpr int MAX_LOD_LEVELS = 4;
+
 // Hash to hold the target Model matrix spec for each Chess component
 typedef std::unordered_map <std::string, tPosition> tModelMap;
 
@@ -5,6 +5,10 @@ Chess component class definition file
 */
 
 #include "chessComponent.h"
+#include "mesh_lod.h"
+#include "mesh_optimize.h"
+#include <algorithm>
+#include <cmath>
 
 
 // Compute the Geometric center
@@ -51,6 +55,114 @@ void chessComponent::getBoundingBox()
     }
 }
 
+// Hash the indices and the centred, quantised vertex positions
+// Inputs: None
+// Output: Hash of the geometry
+uint64_t chessComponent::hashGeometry()
+{
+    // FNV-1a over the values that have to match exactly or nearly
+    uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&hash](uint64_t value)
+    {
+        for (int b = 0; b < 8; b++)
+        {
+            hash ^= (value >> (8 * b)) & 0xFF;
+            hash *= 1099511628211ULL;
+        }
+    };
+
+    mix(vertices.size());
+    mix(indices.size());
+    for (const auto& index : indices)
+    {
+        mix(index);
+    }
+
+    if (vertices.empty())
+    {
+        return hash;
+    }
+
+    // Positions relative to the centre, so the same shape placed elsewhere
+    // in the file still matches
+    getBoundingBox();
+    float quantum = std::max(glm::length(cBoundingLimitsMax - cBoundingLimitsMin), 1e-6f) * 1e-4f;
+    for (const auto& vertex : vertices)
+    {
+        glm::vec3 p = vertex - cGeometricCener;
+        mix(static_cast<uint64_t>(std::llround(p.x / quantum)));
+        mix(static_cast<uint64_t>(std::llround(p.y / quantum)));
+        mix(static_cast<uint64_t>(std::llround(p.z / quantum)));
+    }
+    return hash;
+}
+
+// Compare with another mesh, vertex by vertex
+// Inputs: Mesh to compare with
+// Output: True if both draw the same shape
+bool chessComponent::sameGeometry(const chessComponent& other) const
+{
+    if (geometryHash != other.geometryHash ||
+        vertices.size() != other.vertices.size() ||
+        uvs.size() != other.uvs.size() ||
+        normals.size() != other.normals.size() ||
+        indices != other.indices)
+    {
+        return false;
+    }
+
+    // The hash may collide, so check the vertices as well
+    float tolerance = glm::length(cBoundingLimitsMax - cBoundingLimitsMin) * 1e-4f;
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        glm::vec3 d = glm::abs((vertices[i] - cGeometricCener) - (other.vertices[i] - other.cGeometricCener));
+        if (d.x > tolerance || d.y > tolerance || d.z > tolerance)
+        {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < uvs.size(); i++)
+    {
+        if (std::fabs(uvs[i].x - other.uvs[i].x) > 1e-5f ||
+            std::fabs(uvs[i].y - other.uvs[i].y) > 1e-5f)
+        {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < normals.size(); i++)
+    {
+        glm::vec3 d = glm::abs(normals[i] - other.normals[i]);
+        if (d.x > 1e-4f || d.y > 1e-4f || d.z > 1e-4f)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Bake the translation that moves the mesh to the origin
+// Inputs: None
+// Output: None
+void chessComponent::bakePreTransform()
+{
+    // We want the board surface to be in the X/Z plane. Need to move in -y direction
+    // equal to board's height.
+    glm::vec3 toOrigin;
+    if (cIsBoard)
+    { // For Chess board eliminate the height by pushing it down by the height
+        // Apply the adjustment (Z is compensated to push the board down by depth)
+        toOrigin = glm::vec3(-cGeometricCener.x, -cGeometricCener.y, -cGeometricCener.z/2);
+    }
+    else
+    { // For all others get to X/Z plane with Y=0
+        toOrigin = glm::vec3(-cGeometricCener.x, 0.f, -cGeometricCener.z);
+    }
+    // Shared geometry is stored around another mesh's centre, and quantised geometry
+    // inside a unit box
+    cPreTransform = glm::translate(glm::mat4(1.0f), toOrigin + cSharedOffset + cQuantOffset) *
+                    glm::scale(glm::mat4(1.0f), glm::vec3(cQuantScale));
+}
+
 // Constructor function
 chessComponent::chessComponent()
 {
@@ -71,14 +183,24 @@ chessComponent::chessComponent()
     normals.clear();
 
     // OpenGL Buffers management
-    vertexbuffer = 0;
-    uvbuffer = 0;
-    normalbuffer = 0;
-    elementbuffer = 0;
+    arenaMesh = -1;
+    for (int l = 0; l < MAX_LOD_LEVELS; l++)
+    {
+        lodMeshes[l] = -1;
+    }
+    lodCount = 0;
+    ownsGeometry = true;
+    cSharedOffset = glm::vec3(0.0f);
+    geometryHash = 0;
 
     // Component ID
     cName = "";
     cTextureFile = "";
+    cIsBoard = false;
+    cFlipZ = false;
+    cPreTransform = glm::mat4(1.0f);
+    cQuantOffset = glm::vec3(0.0f);
+    cQuantScale = 1.0f;
 
     // Reset the geometric center
     cGeometricCener = glm::vec3(0.0f);
@@ -86,7 +208,8 @@ chessComponent::chessComponent()
     cBoundingLimitsMin = glm::vec3(0.0f);
 
     // Reset the Texture handle
-    Texture = 0;
+    textureHandle = -1;
+    textureCache = nullptr;
 }
 
 // Destructor function
@@ -150,145 +273,276 @@ void chessComponent::addFaceIndices(unsigned int *objFaceIndice)
     indices.push_back(objFaceIndice[2]);
 }
 
-// Setup rendering buffers
+// Reorder triangles and vertices for the vertex cache, overdraw and vertex fetch
 // Inputs: None
 // Output: None
-void chessComponent::setupGLBuffers()
+void chessComponent::optimizeMesh()
 {
-    // Load it into a VBO
-    glGenBuffers(1, &vertexbuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), &vertices[0], GL_STATIC_DRAW);
-    
-    // Load it into UV Buffer
-    glGenBuffers(1, &uvbuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, uvbuffer);
-    glBufferData(GL_ARRAY_BUFFER, uvs.size() * sizeof(glm::vec2), &uvs[0], GL_STATIC_DRAW);
-    
-    // Load it into the normals buffer
-    glGenBuffers(1, &normalbuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, normalbuffer);
-    glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3), &normals[0], GL_STATIC_DRAW);
-
-    // Generate a buffer for the indices as well
-    glGenBuffers(1, &elementbuffer);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementbuffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned short), &indices[0], GL_STATIC_DRAW);
-
-    // Compute the Geometric center
-    getGeometricCenter();
+    cacheStatsBefore = analyzeVertexCache(indices, vertices.size());
+
+    // Triangles first, then number the vertices in the order those triangles use them
+    optimizeTriangleOrder(indices, vertices);
+    std::vector<unsigned int> oldIndex = optimizeVertexFetch(indices, vertices.size());
+    std::vector<glm::vec3> newVertices(oldIndex.size());
+    std::vector<glm::vec2> newUvs(oldIndex.size(), glm::vec2(0.0f));
+    std::vector<glm::vec3> newNormals(oldIndex.size(), glm::vec3(0.0f));
+    for (size_t i = 0; i < oldIndex.size(); i++)
+    {
+        newVertices[i] = vertices[oldIndex[i]];
+        if (oldIndex[i] < uvs.size()) newUvs[i] = uvs[oldIndex[i]];
+        if (oldIndex[i] < normals.size()) newNormals[i] = normals[oldIndex[i]];
+    }
+    vertices.swap(newVertices);
+    uvs.swap(newUvs);
+    normals.swap(newNormals);
 
+    cacheStatsAfter = analyzeVertexCache(indices, vertices.size());
+    printCacheStats();
 }
 
-// Setup Texture buffers
+// Print the vertex cache efficiency before and after optimizeMesh
 // Inputs: None
 // Output: None
-void chessComponent::setupTexture(GLuint& TextureID)
+void chessComponent::printCacheStats() const
 {
-    // Bind our texture in Texture Unit 0
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, Texture);
-    // Set our "myTextureSampler" sampler to use Texture Unit 0
-    glUniform1i(TextureID, 0);
+    std::cout << cName << ": ACMR " << cacheStatsBefore.acmr << " -> " << cacheStatsAfter.acmr
+              << ", ATVR " << cacheStatsBefore.atvr << " -> " << cacheStatsAfter.atvr << std::endl;
 }
 
-// Setup rendering buffers
+// Compute the geometric centre and the hash identical meshes are matched by, once
+// before setupGLBuffers or shareGLBuffers
 // Inputs: None
+// Output: Hash of the geometry
+uint64_t chessComponent::computeGeometryHash()
+{
+    getGeometricCenter();
+    geometryHash = hashGeometry();
+    return geometryHash;
+}
+
+// Setup rendering buffers
+// Inputs: Scene geometry arena the mesh is packed into
 // Output: None
-void chessComponent::setupTextureBuffers()
+void chessComponent::setupGLBuffers(GeometryArena& arena)
 {
-    // Matching pattern and rule creation
-    // Any combination of 0-9, space in the beginning or end is allowed!
-    // Discarded while converting to integer
-    std::string regexPattern = "\\s*([\\w0-9]+)\\.\\s*";  // Pattern       
-    std::regex  regexRule(regexPattern);                  // Create a custom search rule
-    // Match string
-    std::smatch matches;
-
-    // Perform search on the Texture file name search
-    if (std::regex_search(cTextureFile, matches, regexRule))
+    // The centre and hash come from computeGeometryHash
+    ownsGeometry = true;
+    cSharedOffset = glm::vec3(0.0f);
+
+    // Interleave position, UV and normal so each vertex is fetched from one place
+    std::vector<packedVertexT> packed(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++)
     {
-        // Update the Texture file name (since we only support bmps)
-        cTextureFile = matches[1].str();
-        // Process directory path, it's a short cut for now!
-        if (cTextureFile == "12951_Stone_Chess_Board_diff")
-        { // Chess board directory path
-            cTextureFile = "Lab3/Stone_Chess_Board/" + cTextureFile;
-        }
-        else
-        { // Chess pieces directory path
-            cTextureFile = "Lab3/Chess/" + cTextureFile;
+        packed[i].position = vertices[i];
+        packed[i].uv = (i < uvs.size()) ? uvs[i] : glm::vec2(0.0f);
+        packed[i].normal = (i < normals.size()) ? normals[i] : glm::vec3(0.0f);
+    }
+
+    // Append it to the scene's vertex and index buffers
+    arenaMesh = arena.addMesh(packed, indices);
+    lodMeshes[0] = arenaMesh;
+    lodCount = 1;
+    cQuantOffset = arena.getMesh(arenaMesh).positionOffset;
+    cQuantScale = arena.getMesh(arenaMesh).positionScale;
+    std::cout << cName << ": " << vertices.size() << " vertices, " << vertices.size() * sizeof(packedVertexT)
+              << " -> " << vertices.size() * arena.vertexSize() << " bytes on the GPU" << std::endl;
+
+    // Coarser levels, each about half of the one before, over the same vertices
+    std::vector<unsigned int> lodIndices = indices;
+    while (lodCount < MAX_LOD_LEVELS && lodIndices.size() / 3 >= 2 * MIN_LOD_TRIANGLES)
+    {
+        std::vector<unsigned int> simpler = simplifyMesh(vertices, lodIndices, lodIndices.size() / 6 * 3);
+        // Not worth a level if hardly anything could be collapsed
+        if (simpler.size() * 4 > lodIndices.size() * 3)
+        {
+            break;
         }
-        // Add the bmp extension
-        cTextureFile += ".bmp";
-        // Test print
-        // std::cout << "Texture file is " << cTextureFile << std::endl;
+        lodIndices.swap(simpler);
+        // Collapses leave the triangles in the old order, give each level its own
+        std::vector<unsigned int> ordered = lodIndices;
+        optimizeTriangleOrder(ordered, vertices);
+        lodMeshes[lodCount++] = arena.addLod(arenaMesh, ordered);
     }
-    else
+    std::cout << cName << ": " << lodCount << " levels of detail, " << indices.size() / 3
+              << " to " << lodIndices.size() / 3 << " triangles" << std::endl;
+
+    bakePreTransform();
+}
+
+// Use the geometry of an identical mesh instead of adding it again
+// Inputs: Mesh already set up with its own geometry
+// Output: True if the geometry matched and is shared
+bool chessComponent::shareGLBuffers(const chessComponent& source)
+{
+    // Only share with the owner, its geometry holds its own vertex positions
+    if (!source.ownsGeometry || source.arenaMesh < 0)
     {
-        std::cout << "Texture file not found for chess compoent!" << cName << std::endl;
+        return false;
     }
 
-    // Load the texture
-    Texture = loadBMP_custom(&cTextureFile[0]);
+    // Centre and hash are already computed, see computeGeometryHash
+    if (!sameGeometry(source))
+    {
+        return false;
+    }
+
+    // Reuse the geometry, the texture stays this mesh's own
+    arenaMesh = source.arenaMesh;
+    for (int l = 0; l < MAX_LOD_LEVELS; l++)
+    {
+        lodMeshes[l] = source.lodMeshes[l];
+    }
+    lodCount = source.lodCount;
+    cQuantOffset = source.cQuantOffset;
+    cQuantScale = source.cQuantScale;
+    ownsGeometry = false;
+    // The shared vertices sit around the source's centre, move them onto ours
+    cSharedOffset = cGeometricCener - source.cGeometricCener;
+    bakePreTransform();
+    return true;
 }
 
-// Render a mesh
+// Get the bounding sphere of the vertices drawn
+// Inputs: None
+// Output: Centre and radius
+void chessComponent::getBoundingSphere(glm::vec3& centre, float& radius) const
+{
+    // Shared geometry is the source's copy, which sits cSharedOffset away from our vertices,
+    // and quantised geometry is stored scaled into a unit box
+    centre = ((cBoundingLimitsMin + cBoundingLimitsMax) * 0.5f - cSharedOffset - cQuantOffset) / cQuantScale;
+    radius = glm::length(cBoundingLimitsMax - cBoundingLimitsMin) * 0.5f / cQuantScale;
+}
+
+// Setup rendering buffers
+// Inputs: Scene texture cache the texture is shared through
+// Output: None
+void chessComponent::setupTextureBuffers(TextureCache& cache)
+{
+    // The cache resolves the material's name to a BMP and reads each file only once
+    textureHandle = cache.acquire(cTextureFile);
+    textureCache = &cache;
+    if (textureHandle < 0)
+    {
+        std::cout << "Texture file not found for chess compoent!" << cName << std::endl;
+    }
+}
+
+// Free the CPU copy of the mesh once every mesh is set up
 // Inputs: None
+// Output: Bytes released
+size_t chessComponent::releaseMeshData()
+{
+    size_t bytes = indices.capacity() * sizeof(unsigned int) + vertices.capacity() * sizeof(glm::vec3) +
+                   uvs.capacity() * sizeof(glm::vec2) + normals.capacity() * sizeof(glm::vec3);
+    // The bounding box and centre stay, they are all the render loop needs
+    std::vector<unsigned int>().swap(indices);
+    std::vector<glm::vec3>().swap(vertices);
+    std::vector<glm::vec2>().swap(uvs);
+    std::vector<glm::vec3>().swap(normals);
+    return bytes;
+}
+
+// Append the component's properties and its place in the scene arena to the mesh cache
+// Inputs: Cache being written
 // Output: None
-void chessComponent::renderMesh()
+void chessComponent::writeCache(MeshCacheWriter& writer) const
 {
-    // 1rst attribute buffer : vertices
-    glEnableVertexAttribArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
-    glVertexAttribPointer(
-        0,                  // attribute
-        3,                  // size
-        GL_FLOAT,           // type
-        GL_FALSE,           // normalized?
-        0,                  // stride
-        (void*)0            // array buffer offset
-    );
-
-    // 2nd attribute buffer : UVs
-    glEnableVertexAttribArray(1);
-    glBindBuffer(GL_ARRAY_BUFFER, uvbuffer);
-    glVertexAttribPointer(
-        1,                                // attribute
-        2,                                // size
-        GL_FLOAT,                         // type
-        GL_FALSE,                         // normalized?
-        0,                                // stride
-        (void*)0                          // array buffer offset
-    );
-
-    // 3rd attribute buffer : normals
-    glEnableVertexAttribArray(2);
-    glBindBuffer(GL_ARRAY_BUFFER, normalbuffer);
-    glVertexAttribPointer(
-        2,                                // attribute
-        3,                                // size
-        GL_FLOAT,                         // type
-        GL_FALSE,                         // normalized?
-        0,                                // stride
-        (void*)0                          // array buffer offset
-    );
-
-    // Index buffer
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementbuffer);
-
-    // Draw the triangles !
-    glDrawElements(
-        GL_TRIANGLES,      // mode
-        indices.size(),    // count
-        GL_UNSIGNED_SHORT,   // type
-        (void*)0           // element array buffer offset
-    );
-
-    // Disable the arrays
-    glDisableVertexAttribArray(0);
-    glDisableVertexAttribArray(1);
-    glDisableVertexAttribArray(2);
+    writer.putString(cName);
+    writer.putString(cTextureFile);
+    const bool props[] = { meshProps.hasPositions, meshProps.hasFaces, meshProps.hasNormals,
+                           meshProps.hasTangentsAndBitangents, meshProps.hasVertexColors,
+                           meshProps.hasTextureCoords, meshProps.hasBones };
+    for (bool prop : props)
+    {
+        writer.putValue(static_cast<uint8_t>(prop));
+    }
+    writer.putValue(static_cast<uint32_t>(meshProps.numOfUVChannels));
+    writer.putValue(cGeometricCener);
+    writer.putValue(cBoundingLimitsMin);
+    writer.putValue(cBoundingLimitsMax);
+    writer.putValue(geometryHash);
+    writer.putValue(cacheStatsBefore.acmr);
+    writer.putValue(cacheStatsBefore.atvr);
+    writer.putValue(cacheStatsAfter.acmr);
+    writer.putValue(cacheStatsAfter.atvr);
+
+    // The geometry itself is in the arena's buffers; shared meshes point at their source's
+    writer.putValue(static_cast<uint8_t>(ownsGeometry));
+    writer.putValue(cSharedOffset);
+    writer.putValue(cQuantOffset);
+    writer.putValue(cQuantScale);
+    writer.putValue(static_cast<int32_t>(arenaMesh));
+    writer.putValue(static_cast<int32_t>(lodCount));
+    for (int l = 0; l < lodCount; l++)
+    {
+        writer.putValue(static_cast<int32_t>(lodMeshes[l]));
+    }
+}
+
+// Restore the component from the mesh cache, in place of loading and setting it up
+// Inputs: Cache being read, scene arena already restored from it
+// Output: False if the record is incomplete or points outside the arena
+bool chessComponent::readCache(MeshCacheReader& reader, const GeometryArena& arena)
+{
+    std::string name;
+    reader.getString(name);
+    reader.getString(cTextureFile);
+    storeComponentID(name);
+    bool* props[] = { &meshProps.hasPositions, &meshProps.hasFaces, &meshProps.hasNormals,
+                      &meshProps.hasTangentsAndBitangents, &meshProps.hasVertexColors,
+                      &meshProps.hasTextureCoords, &meshProps.hasBones };
+    for (bool* prop : props)
+    {
+        uint8_t value = 0;
+        reader.getValue(value);
+        *prop = (value != 0);
+    }
+    uint32_t channels = 0;
+    reader.getValue(channels);
+    meshProps.numOfUVChannels = channels;
+    reader.getValue(cGeometricCener);
+    reader.getValue(cBoundingLimitsMin);
+    reader.getValue(cBoundingLimitsMax);
+    reader.getValue(geometryHash);
+    reader.getValue(cacheStatsBefore.acmr);
+    reader.getValue(cacheStatsBefore.atvr);
+    reader.getValue(cacheStatsAfter.acmr);
+    reader.getValue(cacheStatsAfter.atvr);
+
+    uint8_t owned = 0;
+    int32_t mesh = -1, levels = 0;
+    reader.getValue(owned);
+    reader.getValue(cSharedOffset);
+    reader.getValue(cQuantOffset);
+    reader.getValue(cQuantScale);
+    reader.getValue(mesh);
+    reader.getValue(levels);
+    // Every mesh id has to name one of the arena's meshes
+    int meshCount = static_cast<int>(arena.meshCount());
+    if (!reader.ok() || mesh < 0 || mesh >= meshCount || levels < 1 || levels > MAX_LOD_LEVELS)
+    {
+        return false;
+    }
+    for (int l = 0; l < levels; l++)
+    {
+        int32_t lod = -1;
+        if (!reader.getValue(lod) || lod < 0 || lod >= meshCount)
+        {
+            return false;
+        }
+        lodMeshes[l] = lod;
+    }
+    if (lodMeshes[0] != mesh || !(cQuantScale > 0.0f))
+    {
+        return false;
+    }
+    arenaMesh = mesh;
+    lodCount = levels;
+    ownsGeometry = (owned != 0);
+    bakePreTransform();
+    // The optimisation ran when the cache was written, report what it achieved then
+    printCacheStats();
+    return true;
 }
 
 // Render a mesh
@@ -296,13 +550,14 @@ void chessComponent::renderMesh()
 // Output: None
 void chessComponent::deleteGLBuffers()
 {
-    // Cleanup VBO
-    glDeleteBuffers(1, &vertexbuffer);
-    glDeleteBuffers(1, &uvbuffer);
-    glDeleteBuffers(1, &normalbuffer);
-    glDeleteBuffers(1, &elementbuffer);
-    // Cleanup Texture buffer
-    glDeleteTextures(1, &Texture);
+    // Geometry lives in the scene arena, which deletes it
+    // The texture is shared, hand it back to the cache
+    if (textureCache != nullptr)
+    {
+        textureCache->release(textureHandle);
+    }
+    textureHandle = -1;
+    textureCache = nullptr;
 }
 
 // Stores a component ID
@@ -312,6 +567,8 @@ void chessComponent::storeComponentID(std::string cName)
 {
     // Capture the component name
     this->cName = cName;
+    cIsBoard = (this->cName == "12951_Stone_Chess_Board");
+    cFlipZ = (this->cName == "Object3" || this->cName == "ALFIERE3");
     // Testing
     // std::cout << "The child name is " << this->cName << std::endl;
 }
@@ -348,7 +605,7 @@ glm::mat4 chessComponent::genModelMatrix(tPosition& cTPosition)
     if (cTPosition.rAngle != 0.f)
     {
         // Rotate Knight/Bishop by another 180 degree aroudn Z
-        if (cName == "Object3" || cName == "ALFIERE3")
+        if (cFlipZ)
         {
             tModel = glm::rotate(tModel, glm::radians(180.f), {0, 0, 1});
         }
@@ -356,19 +613,8 @@ glm::mat4 chessComponent::genModelMatrix(tPosition& cTPosition)
     }
     // Apply scaling
     tModel = glm::scale(tModel, cTPosition.cScale);
-    // Pull it to origin first (with height adjusted to X/Z plane)!
-    // tModel = glm::translate(tModel, -cGeometricCener);
-    // We want the board surface to be in the X/Z plane. Need to move in -y direction
-    // equal to board's height.
-    if (cName == "12951_Stone_Chess_Board")
-    { // For Chess board eliminate the height by pushing it down by the height
-        // Apply the adjustment (Z is compensated to push the board down by depth)
-        tModel = glm::translate(tModel, {-cGeometricCener.x, -cGeometricCener.y, -cGeometricCener.z/2});
-    }
-    else
-    { // For all others get to X/Z plane with Y=0
-        tModel = glm::translate(tModel, {-cGeometricCener.x, 0.f, -cGeometricCener.z});
-    }
+    // Pull it to origin first (with height adjusted to X/Z plane), baked at load
+    tModel = tModel * cPreTransform;
     // Return the matrix
     return tModel;
 }
@@ -9,8 +9,12 @@ Chess component class header file
 #include <iostream>
 #include <string>
 #include <vector>
-#include <regex>
+#include <cstdint>
 #include "chessCommon.h"
+#include "geometry_arena.h"
+#include "mesh_cache.h"
+#include "mesh_optimize.h"
+#include "texture_cache.h"
 
 // Include GLM
 #include <glm/glm.hpp>
@@ -26,20 +30,38 @@ class chessComponent
 private:
     // Properties of a Chess component
     // mesh
-    std::vector<unsigned short> indices;
+    std::vector<unsigned int> indices;
     std::vector<glm::vec3> vertices;
     std::vector<glm::vec2> uvs;
     std::vector<glm::vec3> normals;
 
     // OpenGL Buffers management
-    GLuint vertexbuffer = 0;
-    GLuint uvbuffer = 0;
-    GLuint normalbuffer = 0;
-    GLuint elementbuffer = 0;
+    // Mesh id in the scene geometry arena, -1 until set up
+    int arenaMesh = -1;
+    // Arena mesh of each level of detail, level 0 is arenaMesh
+    int lodMeshes[MAX_LOD_LEVELS];
+    int lodCount = 0;
+    // False when the geometry belongs to an identical mesh loaded earlier
+    bool ownsGeometry = true;
+    // Moves the shared mesh's vertices onto this mesh's own (centres may differ)
+    glm::vec3 cSharedOffset = { 0, 0, 0 };
+    // Turns the arena's stored positions back into mesh coordinates (quantised arenas)
+    glm::vec3 cQuantOffset = { 0, 0, 0 };
+    float cQuantScale = 1.0f;
+    // Content hash of the mesh relative to its centre
+    uint64_t geometryHash = 0;
+    // Vertex cache efficiency before and after optimizeMesh, kept for the mesh cache
+    vertexCacheStatsT cacheStatsBefore = { 0.0f, 0.0f };
+    vertexCacheStatsT cacheStatsAfter = { 0.0f, 0.0f };
 
     // Component ID
     std::string cName;
     std::string cTextureFile;
+    // Decided from the name once, not on every model matrix
+    bool cIsBoard = false;
+    bool cFlipZ = false;          // Knight/Bishop need another 180 degrees around Z
+    // Moves the mesh to the origin, baked once its geometry is set up
+    glm::mat4 cPreTransform = glm::mat4(1.0f);
 
     // Mesh properties
     meshPropsT meshProps;
@@ -48,7 +70,9 @@ private:
     glm::vec3 cBoundingLimitsMax = { 0, 0, 0 };
 
     // Texture properties
-    GLuint Texture;
+    // Shared handle from the scene's texture cache, -1 if none
+    int textureHandle;
+    TextureCache* textureCache;
 
     // Compute the Geometric center
     // Inputs: None
@@ -60,6 +84,26 @@ private:
     // Output: None
     void getBoundingBox();
 
+    // Hash the indices and the centred, quantised vertex positions
+    // Inputs: None
+    // Output: Hash of the geometry
+    uint64_t hashGeometry();
+
+    // Compare with another mesh, vertex by vertex
+    // Inputs: Mesh to compare with
+    // Output: True if both draw the same shape
+    bool sameGeometry(const chessComponent& other) const;
+
+    // Print the vertex cache efficiency before and after optimizeMesh
+    // Inputs: None
+    // Output: None
+    void printCacheStats() const;
+
+    // Bake the translation that moves the mesh to the origin
+    // Inputs: None
+    // Output: None
+    void bakePreTransform();
+
 
 public:
     // Constructor function
@@ -86,22 +130,55 @@ public:
     // Inputs: Face vertices read from OBJ file
     // Output: None
     void addFaceIndices(unsigned int *objFaceIndice);
-    // Setup rendering buffers
+    // Reorder triangles and vertices for the vertex cache, overdraw and vertex fetch
     // Inputs: None
     // Output: None
-    void setupGLBuffers();
-    // Setup Texture buffers
+    void optimizeMesh();
+    // Compute the geometric centre and the hash identical meshes are matched by, once
+    // before setupGLBuffers or shareGLBuffers
     // Inputs: None
-    // Output: None
-    void setupTextureBuffers();
+    // Output: Hash of the geometry
+    uint64_t computeGeometryHash();
     // Setup rendering buffers
-    // Inputs: None
+    // Inputs: Scene geometry arena the mesh is packed into
     // Output: None
-    void setupTexture(GLuint & TextureID);
-    // Render a mesh
-    // Inputs: None
+    void setupGLBuffers(GeometryArena& arena);
+    // Use the geometry of an identical mesh instead of adding it again
+    // Inputs: Mesh already set up with its own geometry
+    // Output: True if the geometry matched and is shared
+    bool shareGLBuffers(const chessComponent& source);
+    // Setup Texture buffers
+    // Inputs: Scene texture cache the texture is shared through
     // Output: None
-    void renderMesh();
+    void setupTextureBuffers(TextureCache& cache);
+    // Get the texture handle
+    // Inputs: None
+    // Output: Handle in the scene's texture cache, -1 if none
+    int getTextureHandle() const { return textureHandle; }
+    // Get the mesh id in the scene geometry arena
+    // Inputs: Level of detail, 0 is the full mesh; past the coarsest gives the coarsest
+    // Output: Arena mesh id, -1 if not set up
+    int getArenaMesh(int lod = 0) const { return (lodCount == 0) ? arenaMesh : lodMeshes[(lod < lodCount) ? lod : lodCount - 1]; }
+    // Get the number of levels of detail
+    // Inputs: None
+    // Output: Levels, 1 if the mesh could not be simplified
+    int getLodCount() const { return (lodCount == 0) ? 1 : lodCount; }
+    // Get the bounding sphere of the vertices drawn, in the space genModelMatrix maps from
+    // Inputs: None
+    // Output: Centre and radius
+    void getBoundingSphere(glm::vec3& centre, float& radius) const;
+    // Free the CPU copy of the mesh once every mesh is set up
+    // Inputs: None
+    // Output: Bytes released
+    size_t releaseMeshData();
+    // Append the component's properties and its place in the scene arena to the mesh cache
+    // Inputs: Cache being written
+    // Output: None
+    void writeCache(MeshCacheWriter& writer) const;
+    // Restore the component from the mesh cache, in place of loading and setting it up
+    // Inputs: Cache being read, scene arena already restored from it
+    // Output: False if the record is incomplete or points outside the arena
+    bool readCache(MeshCacheReader& reader, const GeometryArena& arena);
     // Render a mesh
     // Inputs: None
     // Output: None
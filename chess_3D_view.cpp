@@ -31,9 +31,11 @@ Description :
 #include <stdio.h>
 #include <stdlib.h>
 #include <vector>
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <iomanip>
+#include <unordered_map>
 #include <sys/select.h>
 #include <unistd.h>
 
@@ -61,13 +63,63 @@ using namespace glm;
 #include "chessCommon.h"
 #include "chess_game.h"
 #include "ECE_ChessEngine.h"
+#include "ECE_SearchEngine.h"
+#include "position_index.h"
+#include "frame_clock.h"
+#include "frame_pacer.h"
+#include "model_cache.h"
+#include "render_buffers.h"
+#include "geometry_arena.h"
+#include "frustum.h"
+#include "mesh_lod.h"
+#include "texture_cache.h"
+#include "mesh_cache.h"
 
 
 // Global chess game instance
 ChessGame gChessGame;
 glm::vec3 globalLightPos = glm::vec3(0, 0, 15);
 float globalLightPower = 1.0f;
-ECE_ChessEngine chessEngine;
+ECE_ChessEngine komodoEngine;
+ECE_SearchEngine searchEngine;
+ECE_EngineInterface* chessEngine = &komodoEngine;
+bool komodoAvailable = false;
+// Levels up to this one are played by the built-in engine
+const int BUILTIN_MAX_LEVEL = 8;
+// Game database position index
+PositionIndex gPositionIndex;
+const char* POSITION_INDEX_FILE = "games.idx";
+// Set while the engine searches its reply in the background
+bool engineThinking = false;
+// Set while the built-in engine searches a hint in the background
+bool hintPending = false;
+// Render loop pacing; the scene is only redrawn when something changed
+FramePacer framePacer;
+bool sceneDirty = true;
+// How often the built-in engine is checked for its reply while idle (seconds)
+const double ENGINE_POLL_INTERVAL = 0.05;
+// Instance records the ring starts with per frame; it grows when a scene needs more
+const unsigned int INSTANCES_PER_FRAME = 128;
+// Store the scene's vertices quantised, 16 bytes each instead of 32
+const bool QUANTISED_VERTICES = true;
+// Processed meshes of the OBJ files, rebuilt whenever one of them changes
+const char* MESH_CACHE_FILE = "Lab3/chess_meshes.cache";
+
+// Window contents were damaged (exposed, resized), draw them again
+void windowRefreshCallback(GLFWwindow*)
+{
+    sceneDirty = true;
+}
+
+// Put the current engine on the game's position by replaying the game's moves
+// Inputs: None
+// Output: True if the engine accepted every move
+bool syncEngine()
+{
+    std::vector<std::string> moves;
+    gChessGame.getMoveHistory(moves);
+    return chessEngine->setMoveHistory(moves);
+}
 
 // Sets up the chess board
 void setupChessBoard(tModelMap& cTModelMap);
@@ -97,6 +149,9 @@ int main(void)
         return -1;
     }
     glfwMakeContextCurrent(window);
+    // Swap on vsync, and redraw whenever the window needs it
+    glfwSwapInterval(1);
+    glfwSetWindowRefreshCallback(window, windowRefreshCallback);
 
     // Initialize GLEW
     glewExperimental = true;
@@ -107,12 +162,17 @@ int main(void)
         return -1;
     }
     
-    // Initialize chess engine
-    if (!chessEngine.InitializeEngine()) {
-        std::cerr << "Failed to initialize chess engine\n";
-        return -1;
+    // Initialize chess engines, the built-in one stands in when Komodo cannot be started
+    searchEngine.InitializeEngine();
+    komodoAvailable = komodoEngine.InitializeEngine();
+    if (!komodoAvailable) {
+        std::cerr << "Failed to initialize Komodo, using the built-in engine\n";
+        chessEngine = &searchEngine;
     }
 
+    // Open the game database index if one has been imported
+    gPositionIndex.open(POSITION_INDEX_FILE);
+
     // Ensure we can capture the escape key
     glfwSetInputMode(window, GLFW_STICKY_KEYS, GL_TRUE);
 
@@ -126,136 +186,488 @@ int main(void)
     // Cull triangles which normal is not towards the camera
     glEnable(GL_CULL_FACE);
 
-    GLuint VertexArrayID;
-    glGenVertexArrays(1, &VertexArrayID);
-    glBindVertexArray(VertexArrayID);
+    // Blend captured pieces as they fade out
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     // Create and compile our GLSL program from the shaders
     GLuint programID = LoadShaders("StandardShading.vertexshader", "StandardShading.fragmentshader");
 
-    // Get a handle for our uniforms
-    GLuint MatrixID = glGetUniformLocation(programID, "MVP");
-    GLuint ViewMatrixID = glGetUniformLocation(programID, "V");
-    GLuint ModelMatrixID = glGetUniformLocation(programID, "M");
+    // Get a handle for our uniforms; everything else is in the per-frame uniform block
     GLuint TextureID = glGetUniformLocation(programID, "myTextureSampler");
-    GLuint LightSwitchID = glGetUniformLocation(programID, "lightSwitch");
-    GLuint LightID = glGetUniformLocation(programID, "LightPosition_worldspace");
-    GLuint PowerID = glGetUniformLocation(programID, "lightPower");
-
-    // Load chess components
+    GLuint OctahedralNormalsID = glGetUniformLocation(programID, "octahedralNormals");
+    FrameUniformBuffer frameUniforms;
+    frameUniforms.create(programID);
+    // Instance records of every draw, streamed through a ring of frames in flight
+    InstanceRing instanceRing;
+    instanceRing.create(INSTANCES_PER_FRAME);
+
+    // Every mesh is packed into one scene arena
+    GeometryArena sceneGeometry(QUANTISED_VERTICES);
+
+    // Load chess components. Unless an OBJ changed since it was written, the mesh cache has
+    // them set up already and the arena uploads its buffers straight from the mapped file.
+    std::vector<std::string> meshSources = { "Lab3/Stone_Chess_Board/12951_Stone_Chess_Board_v1_L3.obj",
+                                             "Lab3/Chess/chess-mod.obj" };
+    // The materials name the textures, so editing one makes the cache stale as well
+    std::vector<std::string> meshCacheInputs = meshSources;
+    meshCacheInputs.push_back("Lab3/Stone_Chess_Board/12951_Stone_Chess_Board_v1_L3.mtl");
+    meshCacheInputs.push_back("Lab3/Chess/chess-mod.mtl");
     std::vector<chessComponent> gchessComponents;
-    bool cBoard = loadAssImpLab3("Lab3/Stone_Chess_Board/12951_Stone_Chess_Board_v1_L3.obj", gchessComponents);
-    bool cComps = loadAssImpLab3("Lab3/Chess/chess-mod.obj", gchessComponents);
-
-    if (!cBoard || !cComps) {
-        std::cout << "obj not loading" << std::endl;
-        return -1;
+    MeshCache meshCache;
+    bool meshesCached = meshCache.load(MESH_CACHE_FILE, meshCacheInputs, gchessComponents, sceneGeometry);
+    if (!meshesCached) {
+        bool cBoard = loadAssImpLab3(meshSources[0].c_str(), gchessComponents);
+        bool cComps = loadAssImpLab3(meshSources[1].c_str(), gchessComponents);
+
+        if (!cBoard || !cComps) {
+            std::cout << "obj not loading" << std::endl;
+            return -1;
+        }
     }
     
     // Setup the Chess board locations
     tModelMap cTModelMap;
     setupChessBoard(cTModelMap);
 
-    // Load it into VBO
-    for (auto cit = gchessComponents.begin(); cit != gchessComponents.end(); cit++) {
-        cit->setupGLBuffers();
-        cit->setupTextureBuffers();
+    // Pack the loaded meshes into the arena; meshes identical to one already loaded
+    // (the white and black pieces) share its geometry and only keep their own texture.
+    // Each mesh is hashed once and only compared with the owners of the same hash.
+    if (!meshesCached) {
+        unsigned int sharedMeshes = 0;
+        std::unordered_multimap<uint64_t, size_t> geometryOwners;
+        for (size_t c = 0; c < gchessComponents.size(); c++) {
+            uint64_t hash = gchessComponents[c].computeGeometryHash();
+            bool shared = false;
+            auto candidates = geometryOwners.equal_range(hash);
+            for (auto owner = candidates.first; owner != candidates.second && !shared; ++owner) {
+                shared = gchessComponents[c].shareGLBuffers(gchessComponents[owner->second]);
+            }
+            if (shared) {
+                sharedMeshes++;
+            } else {
+                gchessComponents[c].setupGLBuffers(sceneGeometry);
+                geometryOwners.emplace(hash, c);
+            }
+        }
+        std::cout << sharedMeshes << " of " << gchessComponents.size() << " meshes share geometry" << std::endl;
+        // Keep what Assimp and the optimisation passes produced for the next launch
+        writeMeshCache(MESH_CACHE_FILE, meshCacheInputs, gchessComponents, sceneGeometry);
+    }
+    // Meshes using the same BMP share one cached texture
+    TextureCache sceneTextures;
+    for (auto& component : gchessComponents) component.setupTextureBuffers(sceneTextures);
+    sceneGeometry.upload(instanceRing.getBuffer());
+    // The GPU has its own copy of the cached buffers now
+    meshCache.close();
+    // The GPU has the meshes now, only the bounding volumes are kept on the CPU
+    size_t releasedBytes = 0;
+    for (auto& component : gchessComponents) releasedBytes += component.releaseMeshData();
+    std::cout << "Released " << releasedBytes / 1024 << " KB of CPU mesh data" << std::endl;
+
+    // Textures of similar size share an array; the arrays stay bound, array i on unit i,
+    // and instances pick their array and layer. The pixels stream in over the first frames.
+    sceneTextures.build();
+    sceneTextures.bind(0);
+    std::vector<glm::vec4> componentTexture(gchessComponents.size());
+    auto updateComponentTextures = [&]() {
+        for (size_t c = 0; c < gchessComponents.size(); c++) {
+            textureLocationT location = sceneTextures.getLocation(gchessComponents[c].getTextureHandle());
+            componentTexture[c] = glm::vec4(static_cast<float>(location.array), static_cast<float>(location.layer), 0.0f, 0.0f);
+        }
+    };
+    updateComponentTextures();
+
+    // Resolve the board and piece meshes once, the render loop only works with indices
+    int boardComponent = -1;
+    tPosition boardSpec = cTModelMap["12951_Stone_Chess_Board"];
+    int meshComponent[NUM_PIECE_MESHES];
+    tPosition meshSpec[NUM_PIECE_MESHES];
+    for (int m = 0; m < NUM_PIECE_MESHES; m++) {
+        meshComponent[m] = -1;
+        meshSpec[m] = cTModelMap[PIECE_MESH_NAMES[m]];
+        // board position comes from the piece motion in the vertex shader
+        meshSpec[m].tPos = glm::vec3(0);
+    }
+    for (size_t c = 0; c < gchessComponents.size(); c++) {
+        std::string name = gchessComponents[c].getComponentID();
+        if (name == "12951_Stone_Chess_Board") {
+            boardComponent = static_cast<int>(c);
+        }
+        for (int m = 0; m < NUM_PIECE_MESHES; m++) {
+            if (name == PIECE_MESH_NAMES[m]) meshComponent[m] = static_cast<int>(c);
+        }
+    }
+    // The board never moves, its position is baked into its model matrix
+    instanceDataT boardInstance;
+    boardInstance.motionFrom = glm::vec4(0.0f);
+    boardInstance.motionTo = glm::vec4(0.0f);
+    boardInstance.motionParams = glm::vec4(0.0f, 0.0f, 1.0f, 0.0f);
+    if (boardComponent >= 0) {
+        boardInstance.model = gchessComponents[boardComponent].genModelMatrix(boardSpec);
+        boardInstance.material = componentTexture[boardComponent];
+    }
+    // and so is its bounding sphere
+    glm::vec4 boardBounds = glm::vec4(0.0f);
+    if (boardComponent >= 0) {
+        glm::vec3 centre;
+        float radius;
+        gchessComponents[boardComponent].getBoundingSphere(centre, radius);
+        boardBounds = transformSphere(glm::vec4(centre, radius), boardInstance.model);
+    }
+    // Every copy of a piece mesh starts from the same model matrix; the cache adds
+    // the square of pieces at rest and keeps their MVP between frames
+    ModelMatrixCache modelCache;
+    for (int m = 0; m < NUM_PIECE_MESHES; m++) {
+        if (meshComponent[m] >= 0) {
+            modelCache.setMeshModel(m, gchessComponents[meshComponent[m]].genModelMatrix(meshSpec[m]));
+            glm::vec3 centre;
+            float radius;
+            gchessComponents[meshComponent[m]].getBoundingSphere(centre, radius);
+            modelCache.setMeshBounds(m, centre, radius);
+        }
     }
+    // Instances of each arena mesh in the current pass, and the frame's draw commands
+    std::vector<std::vector<instanceDataT>> arenaInstances(sceneGeometry.meshCount());
+    for (auto& list : arenaInstances) list.reserve(MAX_PIECES);
+    std::vector<drawCommandT> drawCommands;
+    drawCommands.reserve(2 * sceneGeometry.meshCount() + 1);
+    // Frustum culling: visibility of each piece this frame, and the counters the stats command shows
+    uint8_t pieceVisible[MAX_PIECES];
+    std::vector<uint8_t> arenaCulled(sceneGeometry.meshCount());
+    cullStatsT cullStats = { 0, 0, 0, 0 };
+    unsigned long long totalTested = 0;
+    unsigned long long totalCulled = 0;
+    // Level of detail each piece and the board were drawn with, kept for the hysteresis
+    uint8_t pieceLod[MAX_PIECES] = { 0 };
+    int boardLod = 0;
+    unsigned int lodInstances[MAX_LOD_LEVELS] = { 0 };
 
     // Use our shader
     glUseProgram(programID);
-    //glUniform1f(PowerID, 1.0f);
-    glUniform1f(PowerID, globalLightPower);
+    // Sampler i reads texture unit i
+    GLint textureUnits[MAX_TEXTURE_ARRAYS];
+    for (int unit = 0; unit < MAX_TEXTURE_ARRAYS; unit++) textureUnits[unit] = unit;
+    glUniform1iv(TextureID, MAX_TEXTURE_ARRAYS, textureUnits);
+    glUniform1i(OctahedralNormalsID, sceneGeometry.isQuantised() ? 1 : 0);
+
+    // One clock for camera, animations and engine polling; simulation runs in fixed steps
+    FrameClock frameClock;
+    frameClock.reset(glfwGetTime());
+    bool wasActive = false;
+    framePacer.start();
+
+    // Draws the whole scene, alpha (0..1) interpolates between the last two simulation steps
+    auto renderScene = [&](float alpha) {
+        // Clear the screen
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        // Compute the MVP matrix from keyboard and mouse input, between the last two steps
+        computeMatricesFromInputsLab3(alpha);
+        glm::mat4 ProjectionMatrix = getProjectionMatrix();
+        glm::mat4 ViewMatrix = getViewMatrix();
+
+        // Per-frame uniforms in one upload, the shader moves every piece from the one clock
+        glm::mat4 ViewProjectionMatrix = ProjectionMatrix * ViewMatrix;
+        float animTime = gChessGame.getAnimationTime() + alpha * frameClock.getStep();
+        frameBlockT frameBlock;
+        frameBlock.VP = ViewProjectionMatrix;
+        frameBlock.V = ViewMatrix;
+        frameBlock.lightPosition = glm::vec4(globalLightPos, 1.0f);
+        frameBlock.lightPower = globalLightPower;
+        frameBlock.lightSwitch = getLightSwitch() ? 1 : 0;
+        frameBlock.animTime = animTime;
+        frameBlock.pad = 0.0f;
+        frameUniforms.update(frameBlock);
+
+        // Write every instance of the frame into the ring and list a draw command per
+        // mesh, then submit the whole scene at once. Each piece is drawn in one of the two
+        // passes, so the board and the pieces bound what a frame writes.
+        const PieceTable& pieces = gChessGame.getPieces();
+        unsigned int frameInstances = (boardComponent >= 0 ? 1u : 0u) + static_cast<unsigned int>(pieces.count);
+        if (instanceRing.reserve(frameInstances)) {
+            sceneGeometry.setInstanceBuffer(instanceRing.getBuffer());
+            std::cout << "Instance ring grown to " << instanceRing.capacity() << " instances per frame" << std::endl;
+        }
+        instanceRing.beginFrame();
+        drawCommands.clear();
+        unsigned int baseInstance = 0;
+        frustumT frustum = extractFrustum(ViewProjectionMatrix);
+        cullStats = { 0, 0, 0, 0 };
+        // Levels of detail go by size on screen
+        int fbWidth, fbHeight;
+        glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+        float projScale = ProjectionMatrix[1][1] * 0.5f * static_cast<float>(fbHeight);
+        for (int l = 0; l < MAX_LOD_LEVELS; l++) lodInstances[l] = 0;
+        uint8_t boardVisible = 0;
+        if (boardComponent >= 0) {
+            cullStats.tested++;
+            if (cullSpheres(frustum, &boardBounds, 1, &boardVisible) == 0) {
+                cullStats.culled++;
+                cullStats.drawsCulled++;
+            }
+        }
+        if (boardVisible) {
+            const chessComponent& board = gchessComponents[boardComponent];
+            boardLod = selectLod(projectedRadius(boardBounds, ViewMatrix, projScale), boardLod, board.getLodCount());
+            lodInstances[boardLod]++;
+            boardInstance.mvp = ViewProjectionMatrix * boardInstance.model;
+            if (instanceRing.push(&boardInstance, 1, baseInstance)) {
+                drawCommands.push_back(sceneGeometry.makeCommand(board.getArenaMesh(boardLod), 1, baseInstance));
+            } else {
+                std::cout << "Instance ring full, board not drawn" << std::endl;
+            }
+        }
 
-    // For speed computation
-    double lastTime = glfwGetTime();
+        // The pieces come straight from the game's entity table, one command per
+        // arena mesh (white and black copies together): opaque ones first and then
+        // the ones fading in or out over them
+        modelCache.update(pieces, animTime, ViewProjectionMatrix);
+        // Every piece sphere in one SIMD pass, pieces outside the view are never pushed
+        cullSpheres(frustum, modelCache.getBounds(), pieces.count, pieceVisible);
+        for (int pass = 0; pass < 2; pass++) {
+            for (auto& list : arenaInstances) list.clear();
+            std::fill(arenaCulled.begin(), arenaCulled.end(), 0);
+            for (int h = 0; h < pieces.count; h++) {
+                bool fading = pieces.isFading(h);
+                if (!fading && pieces.motionParams[h].z <= 0.0f) continue;
+                if (fading != (pass == 1)) continue;
+                int mesh = pieces.meshId[h];
+                if (meshComponent[mesh] < 0) continue;
+                const chessComponent& component = gchessComponents[meshComponent[mesh]];
+                cullStats.tested++;
+                if (!pieceVisible[h]) {
+                    cullStats.culled++;
+                    arenaCulled[component.getArenaMesh(pieceLod[h])] = 1;
+                    continue;
+                }
+                int lod = selectLod(projectedRadius(modelCache.getBounds()[h], ViewMatrix, projScale),
+                                    pieceLod[h], component.getLodCount());
+                pieceLod[h] = static_cast<uint8_t>(lod);
+                lodInstances[lod]++;
+                int arenaMesh = component.getArenaMesh(lod);
+
+                instanceDataT instance;
+                instance.motionParams = pieces.motionParams[h];
+                if (modelCache.isAtRest(h)) {
+                    // square is already in the model matrix, only the fade is left
+                    instance.motionFrom = glm::vec4(0.0f);
+                    instance.motionTo = glm::vec4(0.0f);
+                    instance.motionParams.x = 0.0f;
+                    instance.motionParams.y = 0.0f;
+                } else {
+                    instance.motionFrom = pieces.motionFrom[h];
+                    instance.motionTo = pieces.motionTo[h];
+                }
+                instance.model = modelCache.getModel(h);
+                instance.mvp = modelCache.getMVP(h);
+                instance.material = componentTexture[meshComponent[mesh]];
+                arenaInstances[arenaMesh].push_back(instance);
+            }
+            for (size_t a = 0; a < arenaInstances.size(); a++) {
+                unsigned int count = static_cast<unsigned int>(arenaInstances[a].size());
+                // a command would have been issued had none of its instances been culled
+                if (count == 0 && arenaCulled[a]) cullStats.drawsCulled++;
+                if (count > 0) {
+                    if (instanceRing.push(arenaInstances[a].data(), count, baseInstance)) {
+                        drawCommands.push_back(sceneGeometry.makeCommand(static_cast<int>(a), count, baseInstance));
+                    } else {
+                        std::cout << "Instance ring full, " << count << " instances not drawn" << std::endl;
+                    }
+                }
+            }
+        }
+        instanceRing.flush();
+        cullStats.draws = static_cast<unsigned int>(drawCommands.size());
+        totalTested += cullStats.tested;
+        totalCulled += cullStats.culled;
+        sceneGeometry.draw(drawCommands.data(), static_cast<unsigned int>(drawCommands.size()));
+        instanceRing.endFrame();
+
+        // Swap buffers
+        glfwSwapBuffers(window);
+    };
     
     char inputBuffer[256];
     int bufferPos = 0;
 
     do {
-    double currentTime = glfwGetTime();
-    float deltaTime = float(currentTime - lastTime);
-    lastTime = currentTime;
-
-    // Update chess animations
-    gChessGame.updateAnimations(deltaTime);
-
-    // Clear the screen
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    // Compute the MVP matrix from keyboard and mouse input
-    computeMatricesFromInputsLab3();
-    glm::mat4 ProjectionMatrix = getProjectionMatrix();
-    glm::mat4 ViewMatrix = getViewMatrix();
-
-    // Get light switch state and pass to shader
-    bool lightSwitch = getLightSwitch();
-    glUniform1i(LightSwitchID, static_cast<int>(lightSwitch));
-    glUniform1f(PowerID, globalLightPower);
-
-    // Render chess components
-    for (auto cit = gchessComponents.begin(); cit != gchessComponents.end(); cit++) {            
-        tPosition cTPosition = cTModelMap[cit->getComponentID()];
-        
-        for (unsigned int pit = 0; pit < cTPosition.rCnt; pit++) {
-            tPosition cTPositionMorph = cTPosition;
-            cTPositionMorph.tPos.x += pit * cTPosition.rDis * CHESS_BOX_SIZE;
-            
-            if (gChessGame.isMoving()) {
-                glm::vec3 gamePos = gChessGame.getPiecePosition(cit->getComponentID());
-                if (gamePos != glm::vec3(0)) {
-                    cTPositionMorph.tPos = gamePos;
-                }
-            }
+    // Upload the textures decoded since the last frame; meshes draw a placeholder until theirs is in
+    if (sceneTextures.update()) {
+        updateComponentTextures();
+        if (boardComponent >= 0) boardInstance.material = componentTexture[boardComponent];
+        sceneDirty = true;
+    }
 
-            glm::mat4 ModelMatrix = cit->genModelMatrix(cTPositionMorph);
-            glm::mat4 MVP = ProjectionMatrix * ViewMatrix * ModelMatrix;
+    // Nothing changes on screen: sleep until a window event, a command or the engine's reply.
+    // The built-in engine has no pipe to watch, so its reply is polled on a timeout.
+    bool active = gChessGame.isMoving() || isCameraMovingLab3() || sceneTextures.isStreaming();
+    // the engine pipe only counts while a reply is expected, anything else is read with the next search
+    framePacer.setEngineFd(engineThinking ? chessEngine->getResponseFd() : -1);
+    if (!active && !sceneDirty) {
+        bool pollEngine = (engineThinking && chessEngine->getResponseFd() < 0) || hintPending;
+        framePacer.waitIdle(pollEngine ? ENGINE_POLL_INTERVAL : -1.0);
+        // idle time is not simulated
+        frameClock.reset(glfwGetTime());
+    } else {
+        framePacer.paceFrame();
+    }
+    glfwPollEvents();
 
-            glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &MVP[0][0]);
-            glUniformMatrix4fv(ModelMatrixID, 1, GL_FALSE, &ModelMatrix[0][0]);
-            glUniformMatrix4fv(ViewMatrixID, 1, GL_FALSE, &ViewMatrix[0][0]);
+    int simSteps = frameClock.advance(glfwGetTime());
+    for (int step = 0; step < simSteps; step++) {
+        updateCameraLab3(frameClock.getStep());
+        gChessGame.updateAnimations(frameClock.getStep());
+    }
 
-            glUniform3f(LightID, globalLightPos.x, globalLightPos.y, globalLightPos.z);
-            glUniform1f(PowerID, globalLightPower);
+    // Play the engine's reply once it has one, without stalling the frame
+    if (engineThinking) {
+        std::string engineMove;
+        bool answered = chessEngine->pollResponseMove(engineMove);
+        framePacer.engineDone();
+        if (answered) {
+            engineThinking = false;
+            sceneDirty = true;
+            if (!engineMove.empty()) {
+                std::cout << "Engine plays: " << engineMove << std::endl;
+                gChessGame.makeMove(engineMove);
+            }
+        }
+    }
 
-            cit->setupTexture(TextureID);
-            cit->renderMesh();
+    // Report the hint once its search has finished
+    if (hintPending) {
+        std::string hintMove;
+        if (searchEngine.pollHint(hintMove)) {
+            hintPending = false;
+            if (hintMove.empty()) {
+                std::cout << "No legal moves\n";
+            } else {
+                std::cout << "Hint: " << hintMove << std::endl;
+            }
         }
     }
 
-    // Swap buffers
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+    // Draw when something changed, plus one last frame once movement stops
+    active = gChessGame.isMoving() || isCameraMovingLab3();
+    if (active || wasActive || sceneDirty) {
+        renderScene(frameClock.getAlpha());
+        sceneDirty = false;
+    }
+    wasActive = active;
 
-    // Check for command input without blocking
-    fd_set readfds;
-    struct timeval tv;
-    FD_ZERO(&readfds);
-    FD_SET(STDIN_FILENO, &readfds);
-    tv.tv_sec = 0;
-    tv.tv_usec = 0;
 
-    // command loops for move, camera, light, quit commands
-    if (select(STDIN_FILENO + 1, &readfds, NULL, NULL, &tv) > 0) {
+    // command loops for move, camera, light, quit commands; the pacer's watcher
+    // thread flags stdin so it is not polled every frame
+    if (framePacer.inputPending()) {
         std::string command;
         std::cout << "Please enter a command: ";
         std::cin >> command;
-
-        if (command == "move") {
+        // any command may change what is on screen
+        sceneDirty = true;
+
+        if ((engineThinking || hintPending) && (command == "move" || command == "hint" ||
+                                                command == "level" || command == "takeback")) {
+            // these need the engine, which is still searching its reply or a hint
+            std::string ignored;
+            std::getline(std::cin, ignored);
+            std::cout << "Engine is thinking, try again when it is done\n";
+        }
+        else if (command == "move") {
             std::string moveStr;
             std::cin >> moveStr;
-            if (moveStr.length() != 4) {
+            moveT parsedMove = ChessBoard::parseUciMove(moveStr);
+            if (parsedMove == NULL_MOVE) {
                 std::cout << "Invalid command or move!!\n";
             } else {
-                if (chessEngine.sendMove(moveStr)) {
-                    std::string engineMove;
-                    if (chessEngine.getResponseMove(engineMove)) {
-                        std::cout << "Engine plays: " << engineMove << std::endl;
+                // a pawn reaching the last rank without a piece letter becomes a queen
+                int movedPiece = gChessGame.getBoard().pieceAt(moveFrom(parsedMove));
+                int toRank = moveTo(parsedMove) / 8;
+                if (moveStr.length() == 4 && pieceType(movedPiece) == PAWN && (toRank == 0 || toRank == 7)) {
+                    moveStr += 'q';
+                }
+                // the reply is picked up by the frame loop when it is ready
+                if (gChessGame.makeMove(moveStr)) {
+                    if (chessEngine->sendMove(moveStr)) {
+                        engineThinking = true;
+                    } else {
+                        // the engine never saw the move, so the game must not keep it either
+                        gChessGame.takeback(1);
+                        syncEngine();
+                        std::cout << "Engine did not take the move " << moveStr << ", it was taken back\n";
                     }
                 }
             }
         }
+        else if (command == "hint") {
+            // searched by the built-in engine in the background, like its replies, and
+            // reported by the frame loop when it is done
+            std::vector<uint64_t> keys;
+            gChessGame.getKeyHistory(keys);
+            if (searchEngine.startHint(gChessGame.getBoard(), keys)) {
+                hintPending = true;
+                std::cout << "Searching for a hint...\n";
+            }
+        }
+        else if (command == "level") {
+            int level;
+            std::cin >> level;
+            if (level < 1 || level > 20) {
+                std::cout << "Invalid command or move!!\n";
+            } else {
+                searchEngine.setStrength(level);
+                if (level <= BUILTIN_MAX_LEVEL || !komodoAvailable) {
+                    chessEngine = &searchEngine;
+                } else {
+                    chessEngine = &komodoEngine;
+                }
+                syncEngine();
+                std::cout << "Level set to: " << level << std::endl;
+            }
+        }
+        else if (command == "takeback") {
+            int plies;
+            std::cin >> plies;
+            if (!std::cin || plies <= 0) {
+                std::cin.clear();
+                std::cout << "Invalid command or move!!\n";
+            } else {
+                // undo on the board (animating backwards) and trim the engine's game to match
+                int undone = gChessGame.takeback(plies);
+                if (!chessEngine->takeback(undone)) {
+                    // the engine's game had fallen out of step, give it the game's moves again
+                    syncEngine();
+                }
+                std::cout << "Took back " << undone << " move(s), "
+                          << (gChessGame.isWhiteToMove() ? "white" : "black") << " to move\n";
+            }
+        }
+        else if (command == "import") {
+            std::string gamesFile;
+            std::cin >> gamesFile;
+            gPositionIndex.close();
+            if (PositionIndex::build(gamesFile, POSITION_INDEX_FILE)) {
+                gPositionIndex.open(POSITION_INDEX_FILE);
+            }
+        }
+        else if (command == "book") {
+            // opening statistics for the current position
+            if (!gPositionIndex.isOpen()) {
+                std::cout << "No game database imported\n";
+            } else {
+                std::vector<moveStatT> stats;
+                gPositionIndex.openingStats(gChessGame.getPositionHash(), stats);
+                unsigned int total = 0;
+                for (const auto& st : stats) total += st.count;
+                if (stats.empty()) {
+                    std::cout << "Position not found in " << gPositionIndex.numGames() << " games\n";
+                }
+                for (const auto& st : stats) {
+                    std::cout << ChessBoard::moveToUci(st.move) << "  " << st.count << "  "
+                              << std::fixed << std::setprecision(1) << (100.0f * st.count / total) << "%\n";
+                }
+            }
+        }
         else if (command == "camera") {
             float theta, phi, r;
             std::cin >> theta >> phi >> r;
@@ -280,7 +692,6 @@ int main(void)
                     r * sin(glm::radians(theta)) * sin(glm::radians(phi)),
                     r * cos(glm::radians(theta))
                 );
-                glUniform3f(LightID, globalLightPos.x, globalLightPos.y, globalLightPos.z);
                 // check to see if the positions are right
                 std::cout << "Light position set to: " << globalLightPos.x << ", " 
                           << globalLightPos.y << ", " << globalLightPos.z << std::endl;
@@ -291,12 +702,33 @@ int main(void)
             std::cin >> powerValue;
             if (powerValue >= 0.0f && powerValue <= 100.0f) {
                 globalLightPower = powerValue / 100.0f;
-                glUniform1f(PowerID, globalLightPower);
                 std::cout << "Light power set to: " << powerValue << std::endl;
             } else {
                 std::cout << "Invalid command or move!!\n";
             }
         }
+        else if (command == "fps") {
+            // frame rate cap while something moves, 0 leaves it to vsync
+            int cap;
+            std::cin >> cap;
+            if (!std::cin || cap < 0 || cap > 1000) {
+                std::cin.clear();
+                std::cout << "Invalid command or move!!\n";
+            } else {
+                framePacer.setFrameCap(cap);
+                std::cout << "Frame rate cap set to: " << cap << std::endl;
+            }
+        }
+        else if (command == "stats") {
+            // frustum culling of the last frame drawn, and since the start
+            std::cout << "Last frame: " << cullStats.tested << " instances tested, " << cullStats.culled
+                      << " culled, " << cullStats.draws << " draw commands, " << cullStats.drawsCulled
+                      << " commands culled" << std::endl;
+            std::cout << "Since start: " << totalCulled << " of " << totalTested << " instances culled" << std::endl;
+            std::cout << "Instances per level of detail:";
+            for (int l = 0; l < MAX_LOD_LEVELS; l++) std::cout << " " << lodInstances[l];
+            std::cout << std::endl;
+        }
         else if (command == "quit") {
             std::cout << "Thanks for playing!!\n";
             break;
@@ -304,14 +736,22 @@ int main(void)
         else {
             std::cout << "Invalid command or move!!\n";
         }
+        framePacer.inputDone();
     }
 
 } while(glfwGetKey(window, GLFW_KEY_ESCAPE) != GLFW_PRESS && 
         glfwWindowShouldClose(window) == 0);
 
+    framePacer.stop();
+
     // Cleanup VBO and shader
+    sceneGeometry.destroy();
+    // Components hand their textures back, the last release deletes the arrays
+    for (auto& component : gchessComponents) component.deleteGLBuffers();
+    sceneTextures.destroy();
+    instanceRing.destroy();
+    frameUniforms.destroy();
     glDeleteProgram(programID);
-    glDeleteVertexArrays(1, &VertexArrayID);
 
     // Close OpenGL window and terminate GLFW
     glfwTerminate();
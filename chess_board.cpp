@@ -0,0 +1,521 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Implementation of the compact board state, its Zobrist hashing and move generation
+*/
+
+#include "chess_board.h"
+#include "chess_tables.h"
+#include <cctype>
+#include <sstream>
+
+namespace {
+
+// splitmix64
+constexpr uint64_t splitmix(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Zobrist keys; a fixed seed keeps hashes stable so index files stay valid between runs
+struct ZobristKeys {
+    uint64_t piece[16][64];
+    uint64_t castling[16];
+    uint64_t epFile[8];
+    uint64_t blackToMove;
+};
+
+constexpr ZobristKeys buildZobristKeys() {
+    ZobristKeys z{};
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    for (int p = 0; p < 16; p++)
+        for (int s = 0; s < 64; s++)
+            z.piece[p][s] = splitmix(seed);
+    for (int c = 0; c < 16; c++) z.castling[c] = splitmix(seed);
+    for (int f = 0; f < 8; f++) z.epFile[f] = splitmix(seed);
+    z.blackToMove = splitmix(seed);
+    return z;
+}
+
+constexpr ZobristKeys ZOBRIST = buildZobristKeys();
+
+// castling rights that survive a move touching each square
+int castleMask(int square) {
+    switch (square) {
+        case 0:  return ~CASTLE_WQ;
+        case 4:  return ~(CASTLE_WK | CASTLE_WQ);
+        case 7:  return ~CASTLE_WK;
+        case 56: return ~CASTLE_BQ;
+        case 60: return ~(CASTLE_BK | CASTLE_BQ);
+        case 63: return ~CASTLE_BK;
+        default: return ~0;
+    }
+}
+
+}
+
+ChessBoard::ChessBoard() {
+    reset();
+}
+
+void ChessBoard::clear() {
+    for (int s = 0; s < 64; s++) squares[s] = PIECE_NONE;
+    for (int p = 0; p < 16; p++) pieceBB[p] = 0;
+    colourBB[0] = colourBB[1] = 0;
+}
+
+void ChessBoard::putPiece(int piece, int square) {
+    uint64_t bit = 1ULL << square;
+    squares[square] = static_cast<uint8_t>(piece);
+    pieceBB[piece] |= bit;
+    colourBB[pieceIsBlack(piece) ? 1 : 0] |= bit;
+}
+
+void ChessBoard::removePiece(int square) {
+    int piece = squares[square];
+    uint64_t bit = 1ULL << square;
+    squares[square] = PIECE_NONE;
+    pieceBB[piece] &= ~bit;
+    colourBB[pieceIsBlack(piece) ? 1 : 0] &= ~bit;
+}
+
+void ChessBoard::movePiece(int from, int to) {
+    int piece = squares[from];
+    removePiece(from);
+    putPiece(piece, to);
+}
+
+void ChessBoard::reset() {
+    static const uint8_t backRank[8] = {ROOK, KNIGHT, BISHOP, QUEEN, KING, BISHOP, KNIGHT, ROOK};
+    clear();
+    for (int f = 0; f < 8; f++) {
+        putPiece(backRank[f], f);
+        putPiece(PAWN, 8 + f);
+        putPiece(PAWN | BLACK_BIT, 48 + f);
+        putPiece(backRank[f] | BLACK_BIT, 56 + f);
+    }
+    whiteToMove = true;
+    castling = CASTLE_WK | CASTLE_WQ | CASTLE_BK | CASTLE_BQ;
+    epSquare = NO_SQUARE;
+    halfmoveClock = 0;
+    fullmoveNumber = 1;
+    hash = computeHash();
+}
+
+/**
+ * set up a position from a FEN string
+ * @param fen position such as "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1"
+ * @return true if the string could be parsed
+ */
+bool ChessBoard::setFEN(const std::string& fen) {
+    clear();
+    size_t i = 0;
+    int rank = 7, file = 0;
+    for (; i < fen.length() && fen[i] != ' '; i++) {
+        char c = fen[i];
+        if (c == '/') {
+            rank--;
+            file = 0;
+        } else if (c >= '1' && c <= '8') {
+            file += c - '0';
+        } else {
+            static const std::string names = "pnbrqk";
+            size_t t = names.find(static_cast<char>(tolower(c)));
+            if (t == std::string::npos || rank < 0 || file > 7) {
+                reset();
+                return false;
+            }
+            putPiece(static_cast<int>(t + 1) | (islower(c) ? BLACK_BIT : 0), rank * 8 + file);
+            file++;
+        }
+    }
+
+    std::string side = "w", rights = "-", ep = "-";
+    int halfmove = 0, fullmove = 1;
+    std::istringstream rest(i < fen.length() ? fen.substr(i) : std::string());
+    rest >> side >> rights >> ep >> halfmove >> fullmove;
+
+    whiteToMove = (side != "b");
+    castling = 0;
+    for (char c : rights) {
+        if (c == 'K') castling |= CASTLE_WK;
+        if (c == 'Q') castling |= CASTLE_WQ;
+        if (c == 'k') castling |= CASTLE_BK;
+        if (c == 'q') castling |= CASTLE_BQ;
+    }
+    epSquare = parseSquare(ep);
+    halfmoveClock = halfmove;
+    fullmoveNumber = fullmove;
+    hash = computeHash();
+    return pieceBB[KING] != 0 && pieceBB[KING | BLACK_BIT] != 0;
+}
+
+/**
+ * check whether an en-passant capture is actually available, so that
+ * transpositions hash the same when it is not
+ * @return true if the side to move has a pawn next to the double-pushed pawn
+ */
+bool ChessBoard::epCapturable() const {
+    if (epSquare == NO_SQUARE) return false;
+    int pawn = whiteToMove ? PAWN : (PAWN | BLACK_BIT);
+    return (ATTACK_TABLES.pawn[whiteToMove ? 1 : 0][epSquare] & pieceBB[pawn]) != 0;
+}
+
+uint64_t ChessBoard::computeHash() const {
+    const ZobristKeys& z = ZOBRIST;
+    uint64_t h = 0;
+    for (int s = 0; s < 64; s++) {
+        if (squares[s] != PIECE_NONE) h ^= z.piece[squares[s]][s];
+    }
+    h ^= z.castling[castling];
+    if (epCapturable()) h ^= z.epFile[epSquare & 7];
+    if (!whiteToMove) h ^= z.blackToMove;
+    return h;
+}
+
+/**
+ * apply a uci move to the board
+ * @param move move such as "e2e4" or "e7e8q"
+ * @return true if the move was applied
+ */
+bool ChessBoard::applyUciMove(const std::string& move) {
+    moveT m = parseUciMove(move);
+    if (m == NULL_MOVE) return false;
+    return applyMove(m);
+}
+
+/**
+ * apply a packed move without keeping undo information. Only checks that the
+ * side to move owns the piece and that its king is not left in check.
+ * @param move packed move
+ * @return true if the move was applied
+ */
+bool ChessBoard::applyMove(moveT move) {
+    int piece = squares[moveFrom(move)];
+    int captured = squares[moveTo(move)];
+    if (piece == PIECE_NONE || pieceIsBlack(piece) == whiteToMove) return false;
+    if (captured != PIECE_NONE && pieceIsBlack(captured) != whiteToMove) return false;
+    undoT undo;
+    return makeMove(move, undo);
+}
+
+/**
+ * make a pseudo-legal move, handling castling, en passant and promotion
+ * @param move packed move
+ * @param undo filled with what is needed to take the move back
+ * @return false if the move leaves the mover's king in check (board unchanged)
+ */
+bool ChessBoard::makeMove(moveT move, undoT& undo) {
+    const ZobristKeys& z = ZOBRIST;
+    int from = moveFrom(move);
+    int to = moveTo(move);
+    int piece = squares[from];
+    int colour = piece & BLACK_BIT;
+    int type = pieceType(piece);
+
+    undo.move = move;
+    undo.captured = squares[to];
+    undo.castling = static_cast<uint8_t>(castling);
+    undo.epSquare = static_cast<uint8_t>(epSquare);
+    undo.halfmoveClock = static_cast<uint16_t>(halfmoveClock);
+    undo.hash = hash;
+
+    // remove state that is about to change from the hash
+    hash ^= z.castling[castling];
+    if (epCapturable()) hash ^= z.epFile[epSquare & 7];
+
+    if (type == PAWN && to == epSquare) {
+        // en passant capture removes the pawn behind the target square
+        int victimSq = colour ? to + 8 : to - 8;
+        undo.captured = squares[victimSq];
+        hash ^= z.piece[undo.captured][victimSq];
+        removePiece(victimSq);
+    } else if (undo.captured != PIECE_NONE) {
+        hash ^= z.piece[undo.captured][to];
+        removePiece(to);
+    }
+
+    hash ^= z.piece[piece][from];
+    removePiece(from);
+    int placed = (type == PAWN && movePromo(move) != 0) ? (movePromo(move) | colour) : piece;
+    putPiece(placed, to);
+    hash ^= z.piece[placed][to];
+
+    // castling moves the rook as well
+    if (type == KING && (to - from == 2 || from - to == 2)) {
+        int rookFrom = (to > from) ? to + 1 : to - 2;
+        int rookTo = (to > from) ? to - 1 : to + 1;
+        int rook = squares[rookFrom];
+        hash ^= z.piece[rook][rookFrom] ^ z.piece[rook][rookTo];
+        movePiece(rookFrom, rookTo);
+    }
+
+    castling &= castleMask(from) & castleMask(to);
+    epSquare = (type == PAWN && (to - from == 16 || from - to == 16)) ? (from + to) / 2 : NO_SQUARE;
+    halfmoveClock = (type == PAWN || undo.captured != PIECE_NONE) ? 0 : halfmoveClock + 1;
+    if (!whiteToMove) fullmoveNumber++;
+    whiteToMove = !whiteToMove;
+
+    // add the new state back into the hash
+    hash ^= z.castling[castling];
+    if (epCapturable()) hash ^= z.epFile[epSquare & 7];
+    hash ^= z.blackToMove;
+
+    // the mover may not leave its own king in check
+    if (isSquareAttacked(lsb(pieceBB[KING | colour]), colour == 0)) {
+        unmakeMove(undo);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * take back a move made with makeMove
+ * @param undo record filled by makeMove
+ */
+void ChessBoard::unmakeMove(const undoT& undo) {
+    whiteToMove = !whiteToMove;
+    if (!whiteToMove) fullmoveNumber--;
+
+    int from = moveFrom(undo.move);
+    int to = moveTo(undo.move);
+    int colour = whiteToMove ? 0 : BLACK_BIT;
+    int original = movePromo(undo.move) != 0 ? (PAWN | colour) : squares[to];
+
+    removePiece(to);
+    putPiece(original, from);
+
+    if (pieceType(original) == KING && (to - from == 2 || from - to == 2)) {
+        int rookFrom = (to > from) ? to + 1 : to - 2;
+        int rookTo = (to > from) ? to - 1 : to + 1;
+        movePiece(rookTo, rookFrom);
+    }
+
+    if (pieceType(original) == PAWN && to == undo.epSquare) {
+        putPiece(undo.captured, colour ? to + 8 : to - 8);
+    } else if (undo.captured != PIECE_NONE) {
+        putPiece(undo.captured, to);
+    }
+
+    castling = undo.castling;
+    epSquare = undo.epSquare;
+    halfmoveClock = undo.halfmoveClock;
+    hash = undo.hash;
+}
+
+// pass the turn, used by null-move pruning
+void ChessBoard::makeNullMove(undoT& undo) {
+    const ZobristKeys& z = ZOBRIST;
+    undo.move = NULL_MOVE;
+    undo.captured = PIECE_NONE;
+    undo.castling = static_cast<uint8_t>(castling);
+    undo.epSquare = static_cast<uint8_t>(epSquare);
+    undo.halfmoveClock = static_cast<uint16_t>(halfmoveClock);
+    undo.hash = hash;
+    if (epCapturable()) hash ^= z.epFile[epSquare & 7];
+    epSquare = NO_SQUARE;
+    halfmoveClock++;
+    whiteToMove = !whiteToMove;
+    hash ^= z.blackToMove;
+}
+
+void ChessBoard::unmakeNullMove(const undoT& undo) {
+    whiteToMove = !whiteToMove;
+    epSquare = undo.epSquare;
+    halfmoveClock = undo.halfmoveClock;
+    hash = undo.hash;
+}
+
+/**
+ * check if a square is attacked
+ * @param square target square
+ * @param byBlack colour of the attacker
+ * @return true if any piece of that colour attacks the square
+ */
+bool ChessBoard::isSquareAttacked(int square, bool byBlack) const {
+    const attackTablesT& t = ATTACK_TABLES;
+    int them = byBlack ? BLACK_BIT : 0;
+    uint64_t occ = occupied();
+    if (t.pawn[byBlack ? 0 : 1][square] & pieceBB[PAWN | them]) return true;
+    if (t.knight[square] & pieceBB[KNIGHT | them]) return true;
+    if (t.king[square] & pieceBB[KING | them]) return true;
+    if (bishopAttacks(t, square, occ) & (pieceBB[BISHOP | them] | pieceBB[QUEEN | them])) return true;
+    if (rookAttacks(t, square, occ) & (pieceBB[ROOK | them] | pieceBB[QUEEN | them])) return true;
+    return false;
+}
+
+bool ChessBoard::inCheck() const {
+    int us = whiteToMove ? 0 : BLACK_BIT;
+    return isSquareAttacked(lsb(pieceBB[KING | us]), whiteToMove);
+}
+
+/**
+ * generate pseudo-legal moves for the side to move
+ * @param moves output list, at least MAX_MOVES long
+ * @param capturesOnly only captures and queen promotions
+ * @return number of moves
+ */
+int ChessBoard::generateMoves(moveT* moves, bool capturesOnly) const {
+    const attackTablesT& t = ATTACK_TABLES;
+    int n = 0;
+    int us = whiteToMove ? 0 : 1;
+    int colour = whiteToMove ? 0 : BLACK_BIT;
+    uint64_t own = colourBB[us];
+    uint64_t enemy = colourBB[us ^ 1];
+    uint64_t occ = own | enemy;
+    uint64_t targets = capturesOnly ? enemy : ~own;
+
+    // pawns
+    int push = whiteToMove ? 8 : -8;
+    int startRank = whiteToMove ? 1 : 6;
+    int promoRank = whiteToMove ? 7 : 0;
+    uint64_t epBit = (epSquare != NO_SQUARE) ? (1ULL << epSquare) : 0;
+    uint64_t pawns = pieceBB[PAWN | colour];
+    while (pawns) {
+        int from = popLsb(pawns);
+        int to = from + push;
+        if (!(occ & (1ULL << to))) {
+            if ((to >> 3) == promoRank) {
+                moves[n++] = encodeMove(from, to, QUEEN);
+                if (!capturesOnly) {
+                    moves[n++] = encodeMove(from, to, KNIGHT);
+                    moves[n++] = encodeMove(from, to, ROOK);
+                    moves[n++] = encodeMove(from, to, BISHOP);
+                }
+            } else if (!capturesOnly) {
+                moves[n++] = encodeMove(from, to);
+                if ((from >> 3) == startRank && !(occ & (1ULL << (to + push)))) {
+                    moves[n++] = encodeMove(from, to + push);
+                }
+            }
+        }
+        uint64_t caps = t.pawn[us][from] & (enemy | epBit);
+        while (caps) {
+            int cto = popLsb(caps);
+            if ((cto >> 3) == promoRank) {
+                moves[n++] = encodeMove(from, cto, QUEEN);
+                moves[n++] = encodeMove(from, cto, KNIGHT);
+                moves[n++] = encodeMove(from, cto, ROOK);
+                moves[n++] = encodeMove(from, cto, BISHOP);
+            } else {
+                moves[n++] = encodeMove(from, cto);
+            }
+        }
+    }
+
+    // pieces
+    for (int type = KNIGHT; type <= KING; type++) {
+        uint64_t bb = pieceBB[type | colour];
+        while (bb) {
+            int from = popLsb(bb);
+            uint64_t att;
+            switch (type) {
+                case KNIGHT: att = t.knight[from]; break;
+                case BISHOP: att = bishopAttacks(t, from, occ); break;
+                case ROOK:   att = rookAttacks(t, from, occ); break;
+                case QUEEN:  att = bishopAttacks(t, from, occ) | rookAttacks(t, from, occ); break;
+                default:     att = t.king[from]; break;
+            }
+            att &= targets;
+            while (att) moves[n++] = encodeMove(from, popLsb(att));
+        }
+    }
+
+    // castling, the king may not pass through or out of check
+    if (!capturesOnly) {
+        int base = whiteToMove ? 0 : 56;
+        int kingSide = whiteToMove ? CASTLE_WK : CASTLE_BK;
+        int queenSide = whiteToMove ? CASTLE_WQ : CASTLE_BQ;
+        bool them = whiteToMove;
+        if ((castling & kingSide) && !(occ & t.between[base + 4][base + 7]) &&
+            !isSquareAttacked(base + 4, them) && !isSquareAttacked(base + 5, them) &&
+            !isSquareAttacked(base + 6, them)) {
+            moves[n++] = encodeMove(base + 4, base + 6);
+        }
+        if ((castling & queenSide) && !(occ & t.between[base + 4][base]) &&
+            !isSquareAttacked(base + 4, them) && !isSquareAttacked(base + 3, them) &&
+            !isSquareAttacked(base + 2, them)) {
+            moves[n++] = encodeMove(base + 4, base + 2);
+        }
+    }
+    return n;
+}
+
+/**
+ * generate fully legal moves for the side to move
+ * @param moves output list, at least MAX_MOVES long
+ * @return number of moves
+ */
+int ChessBoard::generateLegalMoves(moveT* moves) {
+    moveT pseudo[MAX_MOVES];
+    int count = generateMoves(pseudo);
+    int n = 0;
+    undoT undo;
+    for (int i = 0; i < count; i++) {
+        if (makeMove(pseudo[i], undo)) {
+            unmakeMove(undo);
+            moves[n++] = pseudo[i];
+        }
+    }
+    return n;
+}
+
+bool ChessBoard::isLegalMove(moveT move) {
+    moveT moves[MAX_MOVES];
+    int n = generateLegalMoves(moves);
+    for (int i = 0; i < n; i++) {
+        if (moves[i] == move) return true;
+    }
+    return false;
+}
+
+/**
+ * convert "e2"-style notation to a square index
+ * @param square square name
+ * @return square index or NO_SQUARE
+ */
+int ChessBoard::parseSquare(const std::string& square) {
+    if (square.length() != 2) return NO_SQUARE;
+    int file = square[0] - 'a';
+    int rank = square[1] - '1';
+    if (file < 0 || file > 7 || rank < 0 || rank > 7) return NO_SQUARE;
+    return rank * 8 + file;
+}
+
+std::string ChessBoard::squareName(int square) {
+    return std::string(1, static_cast<char>('a' + (square & 7))) +
+           std::string(1, static_cast<char>('1' + (square >> 3)));
+}
+
+/**
+ * parse a uci move string into a packed move
+ * @param move move such as "e2e4" or "e7e8q"
+ * @return packed move, NULL_MOVE if malformed
+ */
+moveT ChessBoard::parseUciMove(const std::string& move) {
+    if (move.length() != 4 && move.length() != 5) return NULL_MOVE;
+    int from = parseSquare(move.substr(0, 2));
+    int to = parseSquare(move.substr(2, 2));
+    if (from == NO_SQUARE || to == NO_SQUARE || from == to) return NULL_MOVE;
+    int promo = 0;
+    if (move.length() == 5) {
+        switch (move[4]) {
+            case 'n': promo = KNIGHT; break;
+            case 'b': promo = BISHOP; break;
+            case 'r': promo = ROOK; break;
+            case 'q': promo = QUEEN; break;
+            default: return NULL_MOVE;
+        }
+    }
+    return encodeMove(from, to, promo);
+}
+
+std::string ChessBoard::moveToUci(moveT move) {
+    static const char promoChar[8] = {0, 0, 'n', 'b', 'r', 'q', 0, 0};
+    std::string s = squareName(moveFrom(move)) + squareName(moveTo(move));
+    if (movePromo(move) != 0) s += promoChar[movePromo(move)];
+    return s;
+}
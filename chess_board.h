@@ -0,0 +1,123 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Compact board state for the chess game. Keeps a mailbox of the 64 squares
+alongside per-piece bitboards, the side to move, castling rights, en-passant square and an
+incrementally updated Zobrist hash. Supports make/unmake and move generation so it can be
+shared by the game database index and the built-in search engine.
+*/
+
+#ifndef CHESS_BOARD_H
+#define CHESS_BOARD_H
+
+#include <cstdint>
+#include <string>
+
+// piece codes, colour is stored in bit 3
+enum {
+    PIECE_NONE = 0,
+    PAWN = 1, KNIGHT = 2, BISHOP = 3, ROOK = 4, QUEEN = 5, KING = 6,
+    BLACK_BIT = 8
+};
+
+// castling right bits
+enum {
+    CASTLE_WK = 1, CASTLE_WQ = 2, CASTLE_BK = 4, CASTLE_BQ = 8
+};
+
+const int NO_SQUARE = 64;
+const int MAX_MOVES = 256;
+
+// packed move: from (6 bits) | to (6 bits) << 6 | promotion piece type (3 bits) << 12
+typedef uint16_t moveT;
+const moveT NULL_MOVE = 0;
+
+inline moveT encodeMove(int from, int to, int promo = 0) {
+    return static_cast<moveT>(from | (to << 6) | (promo << 12));
+}
+inline int moveFrom(moveT m) { return m & 63; }
+inline int moveTo(moveT m) { return (m >> 6) & 63; }
+inline int movePromo(moveT m) { return (m >> 12) & 7; }
+
+inline int pieceType(int piece) { return piece & 7; }
+inline bool pieceIsBlack(int piece) { return (piece & BLACK_BIT) != 0; }
+
+// state needed to take a move back
+struct undoT {
+    moveT move;
+    uint8_t captured;       // piece code removed by the move (PIECE_NONE if quiet)
+    uint8_t castling;
+    uint8_t epSquare;
+    uint16_t halfmoveClock;
+    uint64_t hash;
+};
+
+class ChessBoard {
+private:
+    uint8_t squares[64];   // a1 = 0, h1 = 7, a8 = 56
+    uint64_t pieceBB[16];  // bitboard per piece code
+    uint64_t colourBB[2];  // [0] white, [1] black
+    bool whiteToMove;
+    int castling;          // CASTLE_* bits
+    int epSquare;          // square a pawn can capture onto, or NO_SQUARE
+    int halfmoveClock;
+    int fullmoveNumber;
+    uint64_t hash;
+
+    // hash from scratch, used after reset
+    uint64_t computeHash() const;
+    // whether the side to move has a pawn that can capture en passant
+    bool epCapturable() const;
+
+    void clear();
+    void putPiece(int piece, int square);
+    void removePiece(int square);
+    void movePiece(int from, int to);
+
+public:
+    ChessBoard();
+
+    // standard starting position
+    void reset();
+    // position from Forsyth-Edwards notation
+    bool setFEN(const std::string& fen);
+
+    // apply a move in uci notation (e.g. "e2e4", "e7e8q")
+    bool applyUciMove(const std::string& move);
+    bool applyMove(moveT move);
+
+    // Make a pseudo-legal move. Returns false (and leaves the board unchanged)
+    // if the move would leave the mover's king in check.
+    bool makeMove(moveT move, undoT& undo);
+    void unmakeMove(const undoT& undo);
+    void makeNullMove(undoT& undo);
+    void unmakeNullMove(const undoT& undo);
+
+    // move generation; captures-only lists include promotions
+    int generateMoves(moveT* moves, bool capturesOnly = false) const;
+    int generateLegalMoves(moveT* moves);
+    bool isLegalMove(moveT move);
+
+    bool isSquareAttacked(int square, bool byBlack) const;
+    bool inCheck() const;
+
+    // getters
+    int pieceAt(int square) const { return squares[square]; }
+    uint64_t pieces(int piece) const { return pieceBB[piece]; }
+    uint64_t colourPieces(bool black) const { return colourBB[black ? 1 : 0]; }
+    uint64_t occupied() const { return colourBB[0] | colourBB[1]; }
+    bool isWhiteToMove() const { return whiteToMove; }
+    int getCastling() const { return castling; }
+    int getEpSquare() const { return epSquare; }
+    int getHalfmoveClock() const { return halfmoveClock; }
+    uint64_t getHash() const { return hash; }
+
+    // notation helpers
+    static int parseSquare(const std::string& square);
+    static std::string squareName(int square);
+    static moveT parseUciMove(const std::string& move);
+    static std::string moveToUci(moveT move);
+};
+
+#endif
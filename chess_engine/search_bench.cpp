@@ -0,0 +1,108 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Benchmark for the built-in search engine. Verifies move generation with perft,
+then reports nodes per second and time-to-depth for each thread count.
+usage: chess_search_bench [depth] [max threads]
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../chess_board.h"
+#include "../ECE_SearchEngine.h"
+
+// standard perft positions with known node counts
+struct perftCaseT {
+    const char* fen;
+    int depth;
+    uint64_t nodes;
+};
+
+const perftCaseT PERFT_CASES[] = {
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 4, 197281},
+    {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 3, 97862},
+    {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 4, 43238},
+    {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 3, 62379},
+};
+
+// middlegame positions used for timing
+const char* BENCH_FENS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP3PPP/R2QKB1R w KQ - 0 8",
+    "2r2rk1/1bqnbppp/p2ppn2/1p6/3NP3/1BN1BP2/PPPQ2PP/2KR3R w - - 0 14",
+};
+
+uint64_t perft(ChessBoard& board, int depth) {
+    if (depth == 0) return 1;
+    moveT moves[MAX_MOVES];
+    int count = board.generateMoves(moves);
+    uint64_t nodes = 0;
+    undoT undo;
+    for (int i = 0; i < count; i++) {
+        if (board.makeMove(moves[i], undo)) {
+            nodes += perft(board, depth - 1);
+            board.unmakeMove(undo);
+        }
+    }
+    return nodes;
+}
+
+int main(int argc, char* argv[]) {
+    int depth = argc > 1 ? atoi(argv[1]) : 7;
+    unsigned int maxThreads = argc > 2 ? static_cast<unsigned int>(atoi(argv[2]))
+                                       : std::max(1u, std::thread::hardware_concurrency());
+
+    // move generator sanity check
+    for (const auto& pc : PERFT_CASES) {
+        ChessBoard board;
+        board.setFEN(pc.fen);
+        uint64_t n = perft(board, pc.depth);
+        if (n != pc.nodes) {
+            std::cerr << "perft mismatch for " << pc.fen << ": " << n << " != " << pc.nodes << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+    std::cout << "perft OK\n\n";
+
+    ECE_SearchEngine engine;
+    engine.InitializeEngine();
+
+    // powers of two up to the maximum, plus the maximum itself
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int t = 1; t < maxThreads; t *= 2) threadCounts.push_back(t);
+    threadCounts.push_back(maxThreads);
+
+    std::cout << "threads  depth      nodes        nps   time-to-depth (s)\n";
+    for (unsigned int threads : threadCounts) {
+        searchLimitsT limits = {depth, 0, threads};
+        engine.setLimits(limits);
+
+        uint64_t totalNodes = 0;
+        double totalSeconds = 0;
+        std::vector<double> depthTimes(depth, 0.0);
+        for (const char* fen : BENCH_FENS) {
+            ChessBoard board;
+            board.setFEN(fen);
+            engine.clearHash();
+            searchResultT result;
+            engine.search(board, std::vector<uint64_t>(), result);
+            totalNodes += result.nodes;
+            totalSeconds += result.seconds;
+            for (size_t d = 0; d < result.depthTimes.size() && d < depthTimes.size(); d++) {
+                depthTimes[d] += result.depthTimes[d];
+            }
+        }
+
+        std::cout << std::setw(7) << threads << std::setw(7) << depth << std::setw(11) << totalNodes
+                  << std::setw(11) << static_cast<uint64_t>(totalNodes / std::max(totalSeconds, 1e-9)) << "  ";
+        for (double t : depthTimes) std::cout << " " << std::fixed << std::setprecision(3) << t;
+        std::cout << "\n";
+    }
+    return 0;
+}
@@ -13,8 +13,13 @@ ASSIMP), and a third-party chess engine (i.e. Komodo, see attached file) to crea
 #include <algorithm>
 #include <iostream>
 
-ChessGame::ChessGame() : gameOver(false), whiteToMove(true) {
-    // piece positions stored when game is played
+ChessGame::ChessGame() : animations(2 * MAX_PIECES), gameOver(false), whiteToMove(true), plyCount(0) {
+    // one entity per piece of the starting position
+    pieces.reset(board);
+    for (int i = 0; i < MAX_PIECES; i++) {
+        moveAnim[i] = NO_ANIM;
+        fadeAnim[i] = NO_ANIM;
+    }
 }
 
 // manage the game's states, turns, and valid moves
@@ -33,11 +38,8 @@ bool ChessGame::isValidSquare(const std::string& square) const {
 glm::vec3 ChessGame::squareToPosition(const std::string& square) const {
     if (!isValidSquare(square)) return glm::vec3(0);
     
-    // chess notation to board coordinates
-    float x = (square[0] - 'a' - 3.5f) * CHESS_BOX_SIZE;
-    float y = (square[1] - '1' - 3.5f) * CHESS_BOX_SIZE;
-    
-    return glm::vec3(x, y, PHEIGHT);
+    // chess notation to square index, then the precomputed board coordinates
+    return squareToPosition((square[1] - '1') * 8 + (square[0] - 'a'));
 }
 
 /**
@@ -71,13 +73,62 @@ bool ChessGame::isValidMove(const std::string& from, const std::string& to) cons
     return true;
 }
 
+/**
+ * square index to 3d position
+ * @param square board square index (a1 = 0)
+ * @return position of the square
+ */
+glm::vec3 ChessGame::squareToPosition(int square) const {
+    const squarePosT& p = SQUARE_POSITIONS.pos[square];
+    return glm::vec3(p.x, p.y, p.z);
+}
+
+/**
+ * animate a piece between two positions. If the piece is already moving (several
+ * plies taken back at once) its current animation is retargeted from where it is.
+ * @param piece piece to move
+ * @param fromPos start position
+ * @param toPos end position
+ */
+void ChessGame::animatePiece(pieceHandleT piece, const glm::vec3& fromPos, const glm::vec3& toPos) {
+    // knights hop over the board, everything else slides
+    bool knight = (meshPieceType(pieces.meshId[piece]) == KNIGHT);
+    int curve = knight ? EASE_LINEAR : EASE_IN_OUT;
+    float hop = knight ? KNIGHT_HEIGHT : 0.0f;
+
+    glm::vec3 startPos = fromPos;
+    if (animations.sampleMove(moveAnim[piece], startPos)) {
+        animations.retarget(moveAnim[piece], startPos, toPos);
+    } else {
+        moveAnim[piece] = animations.startMove(piece, fromPos, toPos, MOVEMENT_DURATION, curve, hop);
+    }
+    // the vertex shader plays the same motion from the shared clock
+    pieces.setMotion(piece, startPos, toPos, getAnimationTime(), MOVEMENT_DURATION, curve, hop);
+}
+
+/**
+ * fade a piece from its current opacity
+ * @param piece piece to fade
+ * @param toAlpha final opacity
+ */
+void ChessGame::fadePiece(pieceHandleT piece, float toAlpha) {
+    float fromAlpha = pieces.alpha[piece];
+    animations.sampleFade(fadeAnim[piece], fromAlpha);
+    animations.cancel(fadeAnim[piece]);
+
+    // fades run at a fixed rate, a partial fade takes part of the time
+    float time = std::fabs(toAlpha - fromAlpha) * MOVEMENT_DURATION;
+    fadeAnim[piece] = animations.startFade(piece, fromAlpha, toAlpha, time);
+    pieces.setFade(piece, fromAlpha, toAlpha, getAnimationTime(), MOVEMENT_DURATION);
+}
+
 /**
  * excuting a move in chess game
  * @param move from-to move
  * @return true if move is made
  */
 bool ChessGame::makeMove(const std::string& move) {
-    if (move.length() != 4) return false;
+    if (move.length() != 4 && move.length() != 5) return false;
     
     // from-to square from move square
     std::string from = move.substr(0, 2);
@@ -87,95 +138,174 @@ bool ChessGame::makeMove(const std::string& move) {
         std::cout << "Invalid move: " << move << std::endl;
         return false;
     }
-    
-    // find piece at from
-    std::string movingPiece;
-    glm::vec3 fromPos = squareToPosition(from);
-    for (const auto& pair : piecePositions) {
-        // check if its the same
-        if (glm::length(pair.second - fromPos) < 0.1f) {
-            movingPiece = pair.first;
-            break;
-        }
+
+    // keep the rules-level board (and its hash) in step with the game
+    moveT boardMove = ChessBoard::parseUciMove(move);
+    if (!board.isLegalMove(boardMove)) {
+        std::cout << "Illegal move: " << move << std::endl;
+        return false;
     }
-    
-    if (movingPiece.empty()) {
-        std::cout << "No piece at position: " << from << std::endl;
+    if (plyCount >= MAX_GAME_PLY) {
+        std::cout << "Game is too long to record another move" << std::endl;
         return false;
     }
-    
+
+    int fromSq = moveFrom(boardMove);
+    int toSq = moveTo(boardMove);
+    glm::vec3 fromPos = squareToPosition(fromSq);
+    glm::vec3 toPos = squareToPosition(toSq);
+
+    // en passant takes the pawn behind the target square
+    int victimSq = toSq;
+    if (pieceType(board.pieceAt(fromSq)) == PAWN && toSq == board.getEpSquare()) {
+        victimSq = board.isWhiteToMove() ? toSq - 8 : toSq + 8;
+    }
+
+    int ply = plyCount;
+    movedPieces[ply] = pieces.atSquare(fromSq);
+    capturedPieces[ply] = pieces.atSquare(victimSq);
+    capturedAt[ply] = static_cast<uint8_t>(victimSq);
+    board.makeMove(boardMove, undoStack[ply]);
+    plyCount++;
+
+    // check for capture, the victim fades out while the attacker moves in
+    if (capturedPieces[ply] != NO_PIECE) {
+        pieces.capture(capturedPieces[ply]);
+        fadePiece(capturedPieces[ply], 0.0f);
+        if (onPieceCaptured) {
+            onPieceCaptured(capturedPieces[ply]);
+        }
+    }
+
     // movement animation
-    PieceMovement movement;
-    movement.pieceId = movingPiece;
-    movement.startPos = fromPos;
-    movement.endPos = squareToPosition(to);
-    movement.progress = 0.0f;
-    // check if its a knight
-    movement.isKnight = (movingPiece.find("Object") != std::string::npos || 
-                        movingPiece.find("CAVALLO") != std::string::npos);
-    movement.isCapture = false;
-    
-    // check for capture
-    for (const auto& pair : piecePositions) {
-        if (glm::length(pair.second - movement.endPos) < 0.1f) {
-            movement.isCapture = true;
-            if (onPieceCaptured) {
-                onPieceCaptured(pair.first);
-            }
-            break;
+    if (movedPieces[ply] != NO_PIECE) {
+        pieces.moveTo(movedPieces[ply], toSq);
+        // a promoted pawn takes the mesh of its new piece
+        if (movePromo(boardMove)) {
+            pieces.meshId[movedPieces[ply]] = static_cast<uint8_t>(pieceMeshId(board.pieceAt(toSq)));
         }
+        animatePiece(movedPieces[ply], fromPos, toPos);
     }
-    
-    activeMovements.push_back(movement);
+
+    // castling also slides the rook, started together with the king so both land at once
+    if (pieceType(board.pieceAt(toSq)) == KING && (toSq - fromSq == 2 || fromSq - toSq == 2)) {
+        int rookFrom = toSq > fromSq ? toSq + 1 : toSq - 2;
+        int rookTo = toSq > fromSq ? toSq - 1 : toSq + 1;
+        pieceHandleT rook = pieces.atSquare(rookFrom);
+        if (rook != NO_PIECE) {
+            pieces.moveTo(rook, rookTo);
+            animatePiece(rook, squareToPosition(rookFrom), squareToPosition(rookTo));
+        }
+    }
+
     // next turn
     whiteToMove = !whiteToMove;
     return true;
 }
 
+/**
+ * take back the last ply, animating the pieces backwards
+ * @return true if a ply was taken back
+ */
+bool ChessGame::unmakeMove() {
+    if (plyCount == 0) return false;
+    int ply = --plyCount;
+    const undoT& undo = undoStack[ply];
+    int fromSq = moveFrom(undo.move);
+    int toSq = moveTo(undo.move);
+    glm::vec3 fromPos = squareToPosition(fromSq);
+    glm::vec3 toPos = squareToPosition(toSq);
+
+    board.unmakeMove(undo);
+
+    if (movedPieces[ply] != NO_PIECE) {
+        pieces.moveTo(movedPieces[ply], fromSq);
+        if (movePromo(undo.move)) {
+            pieces.meshId[movedPieces[ply]] = static_cast<uint8_t>(pieceMeshId(board.pieceAt(fromSq)));
+        }
+        animatePiece(movedPieces[ply], toPos, fromPos);
+    }
+
+    // castling puts the rook back as well
+    if (pieceType(board.pieceAt(fromSq)) == KING && (toSq - fromSq == 2 || fromSq - toSq == 2)) {
+        int rookFrom = toSq > fromSq ? toSq + 1 : toSq - 2;
+        int rookTo = toSq > fromSq ? toSq - 1 : toSq + 1;
+        pieceHandleT rook = pieces.atSquare(rookTo);
+        if (rook != NO_PIECE) {
+            pieces.moveTo(rook, rookFrom);
+            animatePiece(rook, squareToPosition(rookTo), squareToPosition(rookFrom));
+        }
+    }
+
+    // the captured piece returns to its square
+    if (capturedPieces[ply] != NO_PIECE) {
+        pieces.restore(capturedPieces[ply], capturedAt[ply]);
+        fadePiece(capturedPieces[ply], 1.0f);
+        if (onPieceRestored) {
+            onPieceRestored(capturedPieces[ply]);
+        }
+    }
+
+    whiteToMove = !whiteToMove;
+    gameOver = false;
+    return true;
+}
+
+/**
+ * take back several plies
+ * @param plies number of plies to undo
+ * @return number of plies actually taken back
+ */
+int ChessGame::takeback(int plies) {
+    int undone = 0;
+    while (undone < plies && unmakeMove()) {
+        undone++;
+    }
+    return undone;
+}
+
+/**
+ * moves played so far in uci notation
+ * @param moves filled with one entry per ply
+ */
+void ChessGame::getMoveHistory(std::vector<std::string>& moves) const {
+    moves.clear();
+    for (int i = 0; i < plyCount; i++) {
+        moves.push_back(ChessBoard::moveToUci(undoStack[i].move));
+    }
+}
+
+void ChessGame::getKeyHistory(std::vector<uint64_t>& keys) const {
+    // every undo record holds the hash from before its move
+    keys.clear();
+    for (int i = 0; i < plyCount; i++) {
+        keys.push_back(undoStack[i].hash);
+    }
+}
+
+/**
+ * advance every running animation
+ * @param deltaTime elapsed time in seconds
+ */
 void ChessGame::updateAnimations(float deltaTime) {
-    for (auto& movement : activeMovements) {
-        movement.progress = std::min(1.0f, movement.progress + deltaTime / MOVEMENT_DURATION);
-        
-        // new position
-        glm::vec3 newPos;
-        if (movement.isKnight) {
-            // for knights
-            float t = movement.progress;
-            newPos = movement.startPos * (1.0f - t) + movement.endPos * t;
-            newPos.z += KNIGHT_HEIGHT * sin(t * M_PI); // Parabolic height
-        } else {
-            // movement for other pieces
-            newPos = glm::mix(movement.startPos, movement.endPos, movement.progress);
+    // in-flight values are evaluated on the GPU, only the final ones land in the entity table
+    animations.update(deltaTime, pieces.worldPos, pieces.alpha);
+
+    // hold finished fades constant so the renderer can tell opaque pieces from fading ones
+    for (int i = 0; i < pieces.count; i++) {
+        if (fadeAnim[i] != NO_ANIM && !animations.isActive(fadeAnim[i])) {
+            fadeAnim[i] = NO_ANIM;
+            pieces.settleFade(static_cast<pieceHandleT>(i));
         }
-        
-        // update piece position
-        piecePositions[movement.pieceId] = newPos;
     }
-    
-    // completed movements
-    activeMovements.erase(
-        std::remove_if(activeMovements.begin(), activeMovements.end(),
-            [](const PieceMovement& m) { return m.progress >= 1.0f; }),
-        activeMovements.end()
-    );
 }
 
 // check if pieces are moving
 bool ChessGame::isMoving() const {
-    return !activeMovements.empty();
+    return animations.activeAnimations() > 0;
 }
 
 bool ChessGame::isCheckmate() const {
     // need to come back for checkmate function!!!
     return false;
 }
-
-/**
- * get position of a piece
- * @param pieceId id to identify each piece
- * @return position of the piece
- */
-glm::vec3 ChessGame::getPiecePosition(const std::string& pieceId) const {
-    auto it = piecePositions.find(pieceId);
-    return (it != piecePositions.end()) ? it->second : glm::vec3(0);
-}
\ No newline at end of file
@@ -12,31 +12,41 @@ ASSIMP), and a third-party chess engine (i.e. Komodo, see attached file) to crea
 
 #include <string>
 #include <vector>
-#include <map>
+#include <array>
 #include <glm/glm.hpp>
 #include <functional>
-
-// chess piece movement animation
-struct PieceMovement {
-    std::string pieceId;
-    glm::vec3 startPos;
-    glm::vec3 endPos;
-    float progress;
-    bool isKnight;
-    bool isCapture;
-};
+#include "chess_board.h"
+#include "piece_table.h"
+#include "animation_pool.h"
 
 class ChessGame {
 private:
     // state of game
-    std::map<std::string, glm::vec3> piecePositions;  // curr position of each piece
-    std::vector<PieceMovement> activeMovements;       // curr animating moves
+    PieceTable pieces;                                // every piece and its curr position
+    AnimationPool animations;                         // curr animating moves and fades
+    animHandleT moveAnim[MAX_PIECES];                 // running move of each piece
+    animHandleT fadeAnim[MAX_PIECES];                 // running fade of each piece
+    ChessBoard board;                                 // rules-level board state
     bool gameOver;
     bool whiteToMove;
+
+    // undo stack, preallocated so making and taking back moves never allocates
+    static const int MAX_GAME_PLY = 1024;
+    std::array<undoT, MAX_GAME_PLY> undoStack;
+    std::array<pieceHandleT, MAX_GAME_PLY> movedPieces;     // piece moved at each ply
+    std::array<pieceHandleT, MAX_GAME_PLY> capturedPieces;  // piece captured at each ply, or NO_PIECE
+    std::array<uint8_t, MAX_GAME_PLY> capturedAt;           // square the captured piece stood on
+    int plyCount;
     
     const float MOVEMENT_DURATION = 2.0f;  // movement speed
     const float KNIGHT_HEIGHT = 2.0f;      // height of knight when jumping
     
+    // start (or retarget) the animation of one piece
+    void animatePiece(pieceHandleT piece, const glm::vec3& fromPos, const glm::vec3& toPos);
+    // fade a piece out (captured) or back in (restored)
+    void fadePiece(pieceHandleT piece, float toAlpha);
+    glm::vec3 squareToPosition(int square) const;
+    
     // validate movement
     bool isValidMove(const std::string& from, const std::string& to) const;
     bool isValidSquare(const std::string& square) const;
@@ -47,18 +57,30 @@ public:
     ChessGame();
     
     // gamestate and movement
-    bool makeMove(const std::string& move); // e.g., "e2e4"
+    bool makeMove(const std::string& move); // e.g., "e2e4", "e7e8q"
+    bool unmakeMove();                      // take back the last ply
+    int takeback(int plies);                // returns the number of plies taken back
+    int getPlyCount() const { return plyCount; }
+    void getMoveHistory(std::vector<std::string>& moves) const;
+    // hashes of the positions before the current one, oldest first, for repetition detection
+    void getKeyHistory(std::vector<uint64_t>& keys) const;
     void updateAnimations(float deltaTime);
     bool isMoving() const;
     bool isCheckmate() const;
     
     // getters
-    glm::vec3 getPiecePosition(const std::string& pieceId) const;
+    glm::vec3 getPiecePosition(pieceHandleT piece) const { return pieces.worldPos[piece]; }
+    const PieceTable& getPieces() const { return pieces; }
+    // clock the piece motions are timed against, drives the vertex shader
+    float getAnimationTime() const { return static_cast<float>(animations.getClock()); }
     bool isGameOver() const { return gameOver; }
     bool isWhiteToMove() const { return whiteToMove; }
+    uint64_t getPositionHash() const { return board.getHash(); }
+    const ChessBoard& getBoard() const { return board; }
     
-    // for piece capture
-    std::function<void(const std::string&)> onPieceCaptured;
+    // for piece capture and its takeback
+    std::function<void(pieceHandleT)> onPieceCaptured;
+    std::function<void(pieceHandleT)> onPieceRestored;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,137 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Bitboard attack tables used by move generation, generated at compile time.
+Bit 0 is a1, bit 63 is h8.
+*/
+
+#ifndef CHESS_TABLES_H
+#define CHESS_TABLES_H
+
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// ray directions, the first four run towards higher square indices
+enum {
+    DIR_N = 0, DIR_NE, DIR_E, DIR_NW,
+    DIR_S, DIR_SW, DIR_W, DIR_SE
+};
+
+struct attackTablesT {
+    uint64_t knight[64];
+    uint64_t king[64];
+    uint64_t pawn[2][64];       // [0] white pawn attacks, [1] black pawn attacks
+    uint64_t rays[8][64];       // squares along each direction, excluding the origin
+    uint64_t between[64][64];   // squares strictly between two aligned squares
+    uint64_t line[64][64];      // full line through two aligned squares (0 if not aligned)
+};
+
+namespace tableGen {
+
+// set the bit for (file, rank) if it is on the board
+constexpr uint64_t squareBit(int file, int rank) {
+    return (file < 0 || file > 7 || rank < 0 || rank > 7) ? 0 : (1ULL << (rank * 8 + file));
+}
+
+constexpr attackTablesT buildAttackTables() {
+    const int knightD[8][2] = {{1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}};
+    const int kingD[8][2] = {{0, 1}, {1, 1}, {1, 0}, {1, -1}, {0, -1}, {-1, -1}, {-1, 0}, {-1, 1}};
+    // file/rank steps matching DIR_N .. DIR_SE
+    const int rayD[8][2] = {{0, 1}, {1, 1}, {1, 0}, {-1, 1}, {0, -1}, {-1, -1}, {-1, 0}, {1, -1}};
+
+    attackTablesT t{};
+    for (int sq = 0; sq < 64; sq++) {
+        int f = sq & 7;
+        int r = sq >> 3;
+        for (int i = 0; i < 8; i++) {
+            t.knight[sq] |= squareBit(f + knightD[i][0], r + knightD[i][1]);
+            t.king[sq] |= squareBit(f + kingD[i][0], r + kingD[i][1]);
+        }
+        t.pawn[0][sq] = squareBit(f - 1, r + 1) | squareBit(f + 1, r + 1);
+        t.pawn[1][sq] = squareBit(f - 1, r - 1) | squareBit(f + 1, r - 1);
+        for (int d = 0; d < 8; d++) {
+            for (int k = 1; k < 8; k++) {
+                t.rays[d][sq] |= squareBit(f + k * rayD[d][0], r + k * rayD[d][1]);
+            }
+        }
+    }
+    // between/line masks from the rays; direction d and d ^ 4 are opposite
+    for (int a = 0; a < 64; a++) {
+        for (int d = 0; d < 8; d++) {
+            uint64_t ray = t.rays[d][a];
+            for (int b = 0; b < 64; b++) {
+                if (ray & (1ULL << b)) {
+                    t.between[a][b] = ray & ~t.rays[d][b] & ~(1ULL << b);
+                    t.line[a][b] = t.rays[d][a] | t.rays[d ^ 4][a] | (1ULL << a);
+                }
+            }
+        }
+    }
+    return t;
+}
+
+}
+
+// Generated at compile time and baked into the binary
+inline constexpr attackTablesT ATTACK_TABLES = tableGen::buildAttackTables();
+
+inline int lsb(uint64_t b) {
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanForward64(&i, b);
+    return static_cast<int>(i);
+#else
+    return __builtin_ctzll(b);
+#endif
+}
+
+inline int msb(uint64_t b) {
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanReverse64(&i, b);
+    return static_cast<int>(i);
+#else
+    return 63 - __builtin_clzll(b);
+#endif
+}
+
+inline int popCount(uint64_t b) {
+#ifdef _MSC_VER
+    return static_cast<int>(__popcnt64(b));
+#else
+    return __builtin_popcountll(b);
+#endif
+}
+
+inline int popLsb(uint64_t& b) {
+    int s = lsb(b);
+    b &= b - 1;
+    return s;
+}
+
+// sliding attacks by ray walking up to the first blocker
+inline uint64_t rayAttacks(const attackTablesT& t, int dir, int sq, uint64_t occ) {
+    uint64_t ray = t.rays[dir][sq];
+    uint64_t blockers = ray & occ;
+    if (blockers) {
+        int b = (dir < DIR_S) ? lsb(blockers) : msb(blockers);
+        ray ^= t.rays[dir][b];
+    }
+    return ray;
+}
+
+inline uint64_t bishopAttacks(const attackTablesT& t, int sq, uint64_t occ) {
+    return rayAttacks(t, DIR_NE, sq, occ) | rayAttacks(t, DIR_NW, sq, occ) |
+           rayAttacks(t, DIR_SE, sq, occ) | rayAttacks(t, DIR_SW, sq, occ);
+}
+
+inline uint64_t rookAttacks(const attackTablesT& t, int sq, uint64_t occ) {
+    return rayAttacks(t, DIR_N, sq, occ) | rayAttacks(t, DIR_E, sq, occ) |
+           rayAttacks(t, DIR_S, sq, occ) | rayAttacks(t, DIR_W, sq, occ);
+}
+
+#endif
@@ -51,25 +51,31 @@ extern float cTheta = 90.0f;   // Initial theta angle
 // Speed
 float speedLab3 = 10.0f;
 
-// Debounce limit
+// Debounce limit, in simulation steps
 const int DEB_LIMIT = 40;
 
-// Creates the view and Projection matrix based on camera controls
-void computeMatricesFromInputsLab3() {
-    // Timer for frame updates
-    static double lastTime = glfwGetTime();
-    double currentTime = glfwGetTime();
-    float deltaTime = float(currentTime - lastTime);
+// Camera position before the last simulation step, rendering interpolates from it
+glm::vec3 prevCameraPos;
+bool prevCameraValid = false;
+
+// Convert the spherical camera coordinates to Cartesian
+static glm::vec3 cameraPosition() {
+    float posX = cRadius * sin(glm::radians(cTheta)) * cos(glm::radians(cPhi));
+    float posY = cRadius * sin(glm::radians(cTheta)) * sin(glm::radians(cPhi));
+    float posZ = cRadius * cos(glm::radians(cTheta));
+    return glm::vec3(posX, posY, posZ);
+}
+
+// Moves the camera from the keyboard, one fixed simulation step
+void updateCameraLab3(float deltaTime) {
+    prevCameraPos = cameraPosition();
+    prevCameraValid = true;
 
     // Debounce counter
     if (dbnceCnt <= DEB_LIMIT) {
         dbnceCnt++;
     }
 
-    // Create origin and up vector
-    glm::vec3 origin = glm::vec3(0, 0, 0);
-    glm::vec3 up = glm::vec3(0, 0, 1);
-
     // w key - move camera closer
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
         float lastcRadius = cRadius;
@@ -124,13 +130,29 @@ void computeMatricesFromInputsLab3() {
         }
     }
 
-    // Convert spherical to Cartesian coordinates
-    float posX = cRadius * sin(glm::radians(cTheta)) * cos(glm::radians(cPhi));
-    float posY = cRadius * sin(glm::radians(cTheta)) * sin(glm::radians(cPhi));
-    float posZ = cRadius * cos(glm::radians(cTheta));
+}
+
+// Whether the camera is moving (or the light toggle is held), so the scene must be redrawn
+bool isCameraMovingLab3() {
+    const int keys[] = { GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_A, GLFW_KEY_D, GLFW_KEY_UP, GLFW_KEY_DOWN, GLFW_KEY_L };
+    for (int key : keys) {
+        if (glfwGetKey(window, key) == GLFW_PRESS) return true;
+    }
+    // still settling from the last step
+    return prevCameraValid && prevCameraPos != cameraPosition();
+}
+
+// Creates the view and Projection matrix based on camera controls
+void computeMatricesFromInputsLab3(float alpha) {
+    // Create origin and up vector
+    glm::vec3 origin = glm::vec3(0, 0, 0);
+    glm::vec3 up = glm::vec3(0, 0, 1);
 
-    // Set up camera position
-    glm::vec3 position = glm::vec3(posX, posY, posZ);
+    // Set up camera position, between the last two simulation steps
+    glm::vec3 position = cameraPosition();
+    if (prevCameraValid) {
+        position = glm::mix(prevCameraPos, position, alpha);
+    }
     float FoV = initialFoV;
 
     // Create projection matrix
@@ -147,6 +169,4 @@ void computeMatricesFromInputsLab3() {
         origin,     // Look at origin
         up          // Up vector
     );
-
-    lastTime = currentTime;
 }
\ No newline at end of file
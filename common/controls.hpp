@@ -29,7 +29,12 @@ bool getLightSwitch();
 //7) The �L� key toggles the specular and diffuse components of the light on and off but leaves the ambient component unchanged.
 //8) Pressing the escape key closes the window and exits the program
 
-void computeMatricesFromInputsLab3();
+// Moves the camera from the keys above, called once per fixed simulation step
+void updateCameraLab3(float deltaTime);
+// Builds the matrices, alpha (0..1) interpolates between the last two steps
+void computeMatricesFromInputsLab3(float alpha);
+// True while a camera key is held or the camera has not settled yet
+bool isCameraMovingLab3();
 
 extern float cRadius;
 extern float cPhi;
@@ -257,6 +257,9 @@ bool loadAssImpLab3(const char* path, std::vector<chessComponent>& gchessCompone
 			gChessComponent->addFaceIndices(&(mesh->mFaces[i].mIndices[0]));
 		}
 
+		// Reorder for the GPU caches; Assimp keeps the triangles in file order
+		gChessComponent->optimizeMesh();
+
 		// Access the material to get the Texture info
 		aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
 		aiString texturePath;
@@ -6,44 +6,30 @@
 
 #include <GLFW/glfw3.h>
 
+#include "texture.hpp"
 
-GLuint loadBMP_custom(const char * imagepath){
 
-	printf("Reading image %s\n", imagepath);
+// Read and check the header of a BMP file, leaves the file at the pixels. Silent, the
+// texture streaming workers call it and the caller reports failures.
+static bool readBMPHeader(FILE * file, unsigned int & imageSize, unsigned int & width, unsigned int & height){
 
 	// Data read from the header of the BMP file
 	unsigned char header[54];
 	unsigned int dataPos;
-	unsigned int imageSize;
-	unsigned int width, height;
-	// Actual RGB data
-	unsigned char * data;
-
-	// Open the file
-	FILE * file = fopen(imagepath,"rb");
-	if (!file){
-		printf("%s could not be opened. Are you in the right directory ? Don't forget to read the FAQ !\n", imagepath);
-		getchar();
-		return 0;
-	}
 
 	// Read the header, i.e. the 54 first bytes
 
 	// If less than 54 bytes are read, problem
 	if ( fread(header, 1, 54, file)!=54 ){ 
-		printf("Not a correct BMP file\n");
-		fclose(file);
-		return 0;
+		return false;
 	}
 	// A BMP files always begins with "BM"
 	if ( header[0]!='B' || header[1]!='M' ){
-		printf("Not a correct BMP file\n");
-		fclose(file);
-		return 0;
+		return false;
 	}
 	// Make sure this is a 24bpp file
-	if ( *(int*)&(header[0x1E])!=0  )         {printf("Not a correct BMP file\n");    fclose(file); return 0;}
-	if ( *(int*)&(header[0x1C])!=24 )         {printf("Not a correct BMP file\n");    fclose(file); return 0;}
+	if ( *(int*)&(header[0x1E])!=0  )         {return false;}
+	if ( *(int*)&(header[0x1C])!=24 )         {return false;}
 
 	// Read the information about the image
 	dataPos    = *(int*)&(header[0x0A]);
@@ -52,17 +38,61 @@ GLuint loadBMP_custom(const char * imagepath){
 	height     = *(int*)&(header[0x16]);
 
 	// Some BMP files are misformatted, guess missing information
-	if (imageSize==0)    imageSize=width*height*3; // 3 : one byte for each Red, Green and Blue component
+	if (imageSize==0)    imageSize=((width*3+3)&~3u)*height; // 3 : one byte for each Red, Green and Blue component, rows padded to 4 bytes
 	if (dataPos==0)      dataPos=54; // The BMP header is done that way
+	return true;
+}
+
+bool readBMP(const char * imagepath, std::vector<unsigned char> & data, unsigned int & width, unsigned int & height){
+
+	unsigned int imageSize;
+
+	// Open the file
+	FILE * file = fopen(imagepath,"rb");
+	if (!file){
+		return false;
+	}
+
+	if (!readBMPHeader(file, imageSize, width, height)){
+		fclose(file);
+		return false;
+	}
 
 	// Create a buffer
-	data = new unsigned char [imageSize];
+	data.resize(imageSize);
 
 	// Read the actual data from the file into the buffer
-	fread(data,1,imageSize,file);
+	size_t got = fread(&data[0],1,imageSize,file);
 
 	// Everything is in memory now, the file can be closed.
 	fclose (file);
+	return got == imageSize;
+}
+
+bool readBMPSize(const char * imagepath, unsigned int & width, unsigned int & height){
+
+	FILE * file = fopen(imagepath,"rb");
+	if (!file){
+		printf("%s could not be opened.\n", imagepath);
+		return false;
+	}
+	unsigned int imageSize;
+	bool valid = readBMPHeader(file, imageSize, width, height);
+	fclose(file);
+	return valid;
+}
+
+GLuint loadBMP_custom(const char * imagepath){
+
+	unsigned int width, height;
+	// Actual RGB data, rows padded to 4 bytes as in the file
+	std::vector<unsigned char> data;
+	printf("Reading image %s\n", imagepath);
+	if (!readBMP(imagepath, data, width, height)){
+		printf("%s could not be opened as a 24-bit BMP. Are you in the right directory ? Don't forget to read the FAQ !\n", imagepath);
+		getchar();
+		return 0;
+	}
 
 	// Create one OpenGL texture
 	GLuint textureID;
@@ -72,10 +102,7 @@ GLuint loadBMP_custom(const char * imagepath){
 	glBindTexture(GL_TEXTURE_2D, textureID);
 
 	// Give the image to OpenGL
-	glTexImage2D(GL_TEXTURE_2D, 0,GL_RGB, width, height, 0, GL_BGR, GL_UNSIGNED_BYTE, data);
-
-	// OpenGL has now copied the data. Free our own version
-	delete [] data;
+	glTexImage2D(GL_TEXTURE_2D, 0,GL_RGB, width, height, 0, GL_BGR, GL_UNSIGNED_BYTE, &data[0]);
 
 	// Poor filtering, or ...
 	//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -124,47 +151,80 @@ GLuint loadBMP_custom(const char * imagepath){
 #define FOURCC_DXT3 0x33545844 // Equivalent to "DXT3" in ASCII
 #define FOURCC_DXT5 0x35545844 // Equivalent to "DXT5" in ASCII
 
-GLuint loadDDS(const char * imagepath){
+// Read and check the header of a DDS file, leaves the file at the mip chain
+static bool readDDSHeader(FILE * fp, unsigned int & width, unsigned int & height, unsigned int & fourCC, unsigned int & mipMapCount){
 
 	unsigned char header[124];
 
-	FILE *fp; 
- 
-	/* try to open the file */ 
-	fp = fopen(imagepath, "rb"); 
-	if (fp == NULL){
-		printf("%s could not be opened. Are you in the right directory ? Don't forget to read the FAQ !\n", imagepath); getchar(); 
-		return 0;
-	}
-   
 	/* verify the type of file */ 
 	char filecode[4]; 
-	fread(filecode, 1, 4, fp); 
-	if (strncmp(filecode, "DDS ", 4) != 0) { 
-		fclose(fp); 
-		return 0; 
+	if (fread(filecode, 1, 4, fp) != 4 || strncmp(filecode, "DDS ", 4) != 0) { 
+		return false; 
 	}
 	
 	/* get the surface desc */ 
-	fread(&header, 124, 1, fp); 
+	if (fread(&header, 124, 1, fp) != 1) {
+		return false;
+	}
+
+	height      = *(unsigned int*)&(header[8 ]);
+	width       = *(unsigned int*)&(header[12]);
+	mipMapCount = *(unsigned int*)&(header[24]);
+	fourCC      = *(unsigned int*)&(header[80]);
+	if (mipMapCount == 0) mipMapCount = 1;
+	return true;
+}
 
-	unsigned int height      = *(unsigned int*)&(header[8 ]);
-	unsigned int width	     = *(unsigned int*)&(header[12]);
-	unsigned int linearSize	 = *(unsigned int*)&(header[16]);
-	unsigned int mipMapCount = *(unsigned int*)&(header[24]);
-	unsigned int fourCC      = *(unsigned int*)&(header[80]);
+bool readDDS(const char * imagepath, std::vector<unsigned char> & data, unsigned int & width, unsigned int & height, unsigned int & fourCC, unsigned int & mipMapCount){
 
+	FILE *fp; 
  
-	unsigned char * buffer;
-	unsigned int bufsize;
+	/* try to open the file */ 
+	fp = fopen(imagepath, "rb"); 
+	if (fp == NULL){
+		return false;
+	}
+
+	if (!readDDSHeader(fp, width, height, fourCC, mipMapCount)) {
+		fclose(fp);
+		return false;
+	}
+
 	/* how big is it going to be including all mipmaps? */ 
-	bufsize = mipMapCount > 1 ? linearSize * 2 : linearSize; 
-	buffer = (unsigned char*)malloc(bufsize * sizeof(unsigned char)); 
-	fread(buffer, 1, bufsize, fp); 
+	unsigned int blockSize = (fourCC == FOURCC_DXT1) ? 8 : 16;
+	size_t bufsize = 0;
+	unsigned int levelWidth = width, levelHeight = height;
+	for (unsigned int level = 0; level < mipMapCount; ++level) {
+		bufsize += ((levelWidth+3)/4)*((levelHeight+3)/4)*blockSize;
+		levelWidth  = levelWidth  > 1 ? levelWidth  / 2 : 1;
+		levelHeight = levelHeight > 1 ? levelHeight / 2 : 1;
+	}
+	data.resize(bufsize);
+	size_t got = fread(&data[0], 1, bufsize, fp); 
 	/* close the file pointer */ 
 	fclose(fp);
+	return got == bufsize;
+}
+
+bool readDDSSize(const char * imagepath, unsigned int & width, unsigned int & height, unsigned int & fourCC, unsigned int & mipMapCount){
+
+	FILE * fp = fopen(imagepath, "rb");
+	if (fp == NULL) return false;
+	bool valid = readDDSHeader(fp, width, height, fourCC, mipMapCount);
+	fclose(fp);
+	return valid;
+}
+
+GLuint loadDDS(const char * imagepath){
+
+	unsigned int width, height, fourCC, mipMapCount;
+	std::vector<unsigned char> data;
+	if (!readDDS(imagepath, data, width, height, fourCC, mipMapCount)){
+		printf("%s could not be opened. Are you in the right directory ? Don't forget to read the FAQ !\n", imagepath); getchar(); 
+		return 0;
+	}
+	unsigned char * buffer = &data[0];
 
-	unsigned int components  = (fourCC == FOURCC_DXT1) ? 3 : 4; 
 	unsigned int format;
 	switch(fourCC) 
 	{ 
@@ -178,7 +238,6 @@ GLuint loadDDS(const char * imagepath){
 		format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; 
 		break; 
 	default: 
-		free(buffer); 
 		return 0; 
 	}
 
@@ -210,8 +269,6 @@ GLuint loadDDS(const char * imagepath){
 
 	} 
 
-	free(buffer); 
-
 	return textureID;
 
 
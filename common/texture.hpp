@@ -1,6 +1,15 @@
 #ifndef TEXTURE_HPP
 #define TEXTURE_HPP
 
+#include <vector>
+
+// Read the pixels of a 24-bit .BMP file: BGR, bottom row first, rows padded to 4 bytes.
+// Prints nothing and never prompts, so it is safe on worker threads; false on any failure.
+bool readBMP(const char * imagepath, std::vector<unsigned char> & data, unsigned int & width, unsigned int & height);
+
+// Read only the size from the header of a 24-bit .BMP file
+bool readBMPSize(const char * imagepath, unsigned int & width, unsigned int & height);
+
 // Load a .BMP file using our custom loader
 GLuint loadBMP_custom(const char * imagepath);
 
@@ -9,6 +18,12 @@ GLuint loadBMP_custom(const char * imagepath);
 //// Load a .TGA file using GLFW's own loader
 //GLuint loadTGA_glfw(const char * imagepath);
 
+// Read the compressed mip chain of a .DDS file, level 0 first. Silent like readBMP.
+bool readDDS(const char * imagepath, std::vector<unsigned char> & data, unsigned int & width, unsigned int & height, unsigned int & fourCC, unsigned int & mipMapCount);
+
+// Read only the header of a .DDS file, false if there is none
+bool readDDSSize(const char * imagepath, unsigned int & width, unsigned int & height, unsigned int & fourCC, unsigned int & mipMapCount);
+
 // Load a .DDS file using GLFW's own loader
 GLuint loadDDS(const char * imagepath);
 
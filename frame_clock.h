@@ -0,0 +1,64 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Frame clock shared by the camera, the piece animations and engine polling.
+Simulation advances in fixed steps so its results do not depend on the frame rate; the
+leftover fraction of a step is used to interpolate when rendering.
+*/
+
+#ifndef FRAME_CLOCK_H
+#define FRAME_CLOCK_H
+
+#include <cstdint>
+
+class FrameClock {
+private:
+    double step;          // simulation step in seconds
+    int maxSteps;         // steps run at most per frame, the rest of a stall is dropped
+    double lastTime;
+    double accumulator;   // real time not yet simulated
+    double frameDelta;
+    uint64_t ticks;
+
+public:
+    explicit FrameClock(double stepSeconds = 1.0 / 120.0, int maxStepsPerFrame = 12)
+        : step(stepSeconds), maxSteps(maxStepsPerFrame), lastTime(0.0),
+          accumulator(0.0), frameDelta(0.0), ticks(0) {}
+
+    // start counting from the given time
+    void reset(double now) {
+        lastTime = now;
+        accumulator = 0.0;
+        frameDelta = 0.0;
+    }
+
+    /**
+     * take the time of a new frame
+     * @param now current time in seconds
+     * @return number of fixed steps to simulate this frame
+     */
+    int advance(double now) {
+        frameDelta = now - lastTime;
+        lastTime = now;
+        accumulator += frameDelta;
+        int steps = static_cast<int>(accumulator / step);
+        if (steps > maxSteps) {
+            // after a long stall, slow down instead of jumping ahead
+            steps = maxSteps;
+            accumulator = steps * step;
+        }
+        accumulator -= steps * step;
+        ticks += steps;
+        return steps;
+    }
+
+    float getStep() const { return static_cast<float>(step); }
+    // how far rendering is between the last simulated step and the next, 0..1
+    float getAlpha() const { return static_cast<float>(accumulator / step); }
+    double getSimTime() const { return ticks * step; }
+    float getFrameDelta() const { return static_cast<float>(frameDelta); }
+    uint64_t getTicks() const { return ticks; }
+};
+
+#endif
@@ -0,0 +1,187 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Implementation of the render loop frame pacer
+*/
+
+#include "frame_pacer.h"
+#include <GLFW/glfw3.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/select.h>
+#include <unistd.h>
+
+// longest the watcher sleeps before rechecking its state
+const int WATCH_INTERVAL_MS = 100;
+
+FramePacer::FramePacer()
+    : quit(false), waiting(false), hasDeadline(false), engineFd(-1),
+      inputReady(false), engineReady(false), frameCap(60) {
+    nextFrame = clockT::now();
+    wakePipe[0] = -1;
+    wakePipe[1] = -1;
+}
+
+FramePacer::~FramePacer() {
+    stop();
+}
+
+void FramePacer::interruptWatcher() {
+    if (wakePipe[1] >= 0) {
+        char byte = 0;
+        ssize_t written;
+        do {
+            written = write(wakePipe[1], &byte, 1);
+        } while (written < 0 && errno == EINTR);
+        // a full pipe (EAGAIN) already holds a wake-up for the watcher
+    }
+}
+
+/**
+ * watch a new engine pipe, or none; readiness of the old one no longer counts
+ * @param fd engine's reply pipe, -1 while no reply is expected
+ */
+void FramePacer::setEngineFd(int fd) {
+    if (engineFd.exchange(fd) != fd) {
+        engineReady = false;
+        interruptWatcher();
+    }
+}
+
+void FramePacer::start() {
+    if (watcher.joinable()) return;
+    if (pipe(wakePipe) == -1) {
+        wakePipe[0] = -1;
+        wakePipe[1] = -1;
+    } else {
+        // neither end may block: the watcher drains until empty, and wake-ups can pile up
+        fcntl(wakePipe[0], F_SETFL, fcntl(wakePipe[0], F_GETFL) | O_NONBLOCK);
+        fcntl(wakePipe[1], F_SETFL, fcntl(wakePipe[1], F_GETFL) | O_NONBLOCK);
+    }
+    quit = false;
+    watcher = std::thread(&FramePacer::watch, this);
+}
+
+void FramePacer::stop() {
+    if (!watcher.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        quit = true;
+    }
+    interruptWatcher();
+    watcher.join();
+    if (wakePipe[0] >= 0) {
+        close(wakePipe[0]);
+        close(wakePipe[1]);
+        wakePipe[0] = -1;
+        wakePipe[1] = -1;
+    }
+}
+
+/**
+ * watcher thread: select() on stdin and the engine pipe and wake the main thread
+ * with an empty GLFW event when either is readable or its wait times out
+ */
+void FramePacer::watch() {
+    while (true) {
+        int timeoutMs = WATCH_INTERVAL_MS;
+        bool deadlinePassed = false;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (quit) return;
+            if (waiting && hasDeadline) {
+                auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - clockT::now()).count();
+                if (left <= 0) {
+                    deadlinePassed = true;
+                    hasDeadline = false;
+                } else if (left < timeoutMs) {
+                    timeoutMs = static_cast<int>(left);
+                }
+            }
+        }
+        if (deadlinePassed) {
+            glfwPostEmptyEvent();
+            continue;
+        }
+
+        // only watch what the main thread has not been told about yet
+        fd_set readfds;
+        FD_ZERO(&readfds);
+        int maxFd = -1;
+        if (wakePipe[0] >= 0) {
+            FD_SET(wakePipe[0], &readfds);
+            maxFd = wakePipe[0];
+        }
+        if (!inputReady) {
+            FD_SET(STDIN_FILENO, &readfds);
+            if (STDIN_FILENO > maxFd) maxFd = STDIN_FILENO;
+        }
+        int fd = engineFd;
+        if (fd >= 0 && !engineReady) {
+            FD_SET(fd, &readfds);
+            if (fd > maxFd) maxFd = fd;
+        }
+        struct timeval tv;
+        tv.tv_sec = 0;
+        tv.tv_usec = timeoutMs * 1000;
+
+        if (select(maxFd + 1, &readfds, NULL, NULL, &tv) > 0) {
+            bool wake = false;
+            if (wakePipe[0] >= 0 && FD_ISSET(wakePipe[0], &readfds)) {
+                // state changed, drain and recompute the timeout
+                char drain[16];
+                ssize_t drained;
+                do {
+                    drained = read(wakePipe[0], drain, sizeof(drain));
+                } while (drained > 0 || (drained < 0 && errno == EINTR));
+            }
+            if (!inputReady && FD_ISSET(STDIN_FILENO, &readfds)) {
+                inputReady = true;
+                wake = true;
+            }
+            // the main thread may have stopped waiting on this pipe during select()
+            if (fd >= 0 && FD_ISSET(fd, &readfds) && engineFd == fd) {
+                engineReady = true;
+                wake = true;
+            }
+            if (wake) glfwPostEmptyEvent();
+        }
+    }
+}
+
+/**
+ * sleep in glfwWaitEvents until something needs the main thread
+ * @param timeout seconds to wait at most, negative to wait without limit
+ */
+void FramePacer::waitIdle(double timeout) {
+    // anything already pending means there is no reason to sleep
+    if (inputReady || (engineReady && engineFd >= 0) || timeout == 0.0) return;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        waiting = true;
+        hasDeadline = (timeout > 0.0);
+        if (hasDeadline) {
+            deadline = clockT::now() + std::chrono::duration_cast<clockT::duration>(std::chrono::duration<double>(timeout));
+        }
+    }
+    interruptWatcher();
+    glfwWaitEvents();
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        waiting = false;
+        hasDeadline = false;
+    }
+    nextFrame = clockT::now();
+}
+
+void FramePacer::paceFrame() {
+    if (frameCap <= 0) return;
+    clockT::time_point now = clockT::now();
+    if (nextFrame > now) {
+        std::this_thread::sleep_until(nextFrame);
+    }
+    // stay on the cadence, but do not try to catch up after a slow frame
+    nextFrame += std::chrono::duration_cast<clockT::duration>(std::chrono::duration<double>(1.0 / frameCap));
+    if (nextFrame < now) nextFrame = now;
+}
@@ -0,0 +1,69 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Frame pacing for the render loop. When nothing on screen changes the loop
+sleeps in glfwWaitEvents, and a watcher thread wakes it (glfwPostEmptyEvent) when a
+command arrives on stdin, the engine writes its reply, or a timeout expires. While
+something moves, frames are held to a configurable rate cap.
+*/
+
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+class FramePacer {
+private:
+    typedef std::chrono::steady_clock clockT;
+
+    std::thread watcher;
+    std::mutex mtx;
+    int wakePipe[2];                // interrupts the watcher's select() when its state changes
+    bool quit;
+    bool waiting;                   // main thread is blocked in waitIdle
+    clockT::time_point deadline;    // wake the main thread at this time while waiting
+    bool hasDeadline;
+
+    std::atomic<int> engineFd;      // -1 when the engine has no pipe to watch
+    std::atomic<bool> inputReady;   // stdin has a command, until inputDone
+    std::atomic<bool> engineReady;  // engine pipe readable, until engineDone
+
+    int frameCap;                   // frames per second while animating, 0 for no cap
+    clockT::time_point nextFrame;
+
+    void watch();
+    void interruptWatcher();
+
+public:
+    FramePacer();
+    ~FramePacer();
+
+    // start and stop the watcher thread; GLFW must be initialised in between
+    void start();
+    void stop();
+
+    void setFrameCap(int fps) { frameCap = fps; }
+    int getFrameCap() const { return frameCap; }
+    // engine pipe to watch, -1 while no reply is expected
+    void setEngineFd(int fd);
+
+    /**
+     * block until a window event, stdin input, engine output or the timeout
+     * @param timeout seconds to wait at most, negative to wait without limit
+     */
+    void waitIdle(double timeout);
+    // sleep as needed to hold the frame rate cap
+    void paceFrame();
+
+    bool inputPending() const { return inputReady; }
+    // the pending command has been read, watch stdin again
+    void inputDone() { inputReady = false; interruptWatcher(); }
+    // the engine output has been read, watch its pipe again
+    void engineDone() { engineReady = false; interruptWatcher(); }
+};
+
+#endif
@@ -0,0 +1,94 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Implementation of frustum culling
+*/
+
+#include "frustum.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define FRUSTUM_SSE 1
+#endif
+
+frustumT extractFrustum(const glm::mat4& VP) {
+    // rows of the (column-major) matrix
+    glm::vec4 row[4];
+    for (int r = 0; r < 4; r++) {
+        row[r] = glm::vec4(VP[0][r], VP[1][r], VP[2][r], VP[3][r]);
+    }
+
+    frustumT frustum;
+    frustum.planes[0] = row[3] + row[0];
+    frustum.planes[1] = row[3] - row[0];
+    frustum.planes[2] = row[3] + row[1];
+    frustum.planes[3] = row[3] - row[1];
+    frustum.planes[4] = row[3] + row[2];
+    frustum.planes[5] = row[3] - row[2];
+
+    // unit normals, so the plane distance can be compared with a radius
+    for (int p = 0; p < 6; p++) {
+        glm::vec4& pl = frustum.planes[p];
+        float length = std::sqrt(pl.x * pl.x + pl.y * pl.y + pl.z * pl.z);
+        if (length > 0.0f) pl = pl * (1.0f / length);
+    }
+    return frustum;
+}
+
+glm::vec4 transformSphere(const glm::vec4& sphere, const glm::mat4& model) {
+    glm::vec4 centre = model * glm::vec4(sphere.x, sphere.y, sphere.z, 1.0f);
+    // the largest axis scale keeps the sphere enclosing under non-uniform scaling
+    float scale = 0.0f;
+    for (int c = 0; c < 3; c++) {
+        const glm::vec4& axis = model[c];
+        scale = std::max(scale, axis.x * axis.x + axis.y * axis.y + axis.z * axis.z);
+    }
+    return glm::vec4(centre.x, centre.y, centre.z, sphere.w * std::sqrt(scale));
+}
+
+int cullSpheres(const frustumT& frustum, const glm::vec4* spheres, int count, uint8_t* visible) {
+    int inside = 0;
+    int i = 0;
+#ifdef FRUSTUM_SSE
+    // four spheres per iteration: transpose to x/y/z/r lanes and test each plane at once
+    for (; i + 4 <= count; i += 4) {
+        __m128 s0 = _mm_loadu_ps(&spheres[i][0]);
+        __m128 s1 = _mm_loadu_ps(&spheres[i + 1][0]);
+        __m128 s2 = _mm_loadu_ps(&spheres[i + 2][0]);
+        __m128 s3 = _mm_loadu_ps(&spheres[i + 3][0]);
+        _MM_TRANSPOSE4_PS(s0, s1, s2, s3);
+        __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), s3);
+
+        // all lanes set; compared from zero so it stays SSE, not SSE2
+        __m128 in = _mm_cmpeq_ps(_mm_setzero_ps(), _mm_setzero_ps());
+        for (int p = 0; p < 6; p++) {
+            const glm::vec4& pl = frustum.planes[p];
+            __m128 d = _mm_add_ps(_mm_mul_ps(s0, _mm_set1_ps(pl.x)), _mm_set1_ps(pl.w));
+            d = _mm_add_ps(d, _mm_mul_ps(s1, _mm_set1_ps(pl.y)));
+            d = _mm_add_ps(d, _mm_mul_ps(s2, _mm_set1_ps(pl.z)));
+            // outside once the centre is further than the radius behind any plane
+            in = _mm_and_ps(in, _mm_cmpge_ps(d, negRadius));
+        }
+        int mask = _mm_movemask_ps(in);
+        for (int k = 0; k < 4; k++) {
+            visible[i + k] = static_cast<uint8_t>((mask >> k) & 1);
+            inside += visible[i + k];
+        }
+    }
+#endif
+    // the rest (or everything without SSE) one at a time
+    for (; i < count; i++) {
+        const glm::vec4& s = spheres[i];
+        bool in = true;
+        for (int p = 0; p < 6 && in; p++) {
+            const glm::vec4& pl = frustum.planes[p];
+            in = pl.x * s.x + pl.y * s.y + pl.z * s.z + pl.w >= -s.w;
+        }
+        visible[i] = in ? 1 : 0;
+        inside += visible[i];
+    }
+    return inside;
+}
@@ -0,0 +1,55 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: View frustum culling of bounding spheres. The six planes are taken from the
+view-projection matrix and the spheres are tested four at a time with SSE.
+*/
+
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+typedef struct
+{
+    // left, right, bottom, top, near, far; xyz normal pointing inwards, w distance
+    glm::vec4 planes[6];
+} frustumT;
+
+// Culling counters of one frame
+typedef struct
+{
+    unsigned int tested;    // instances tested
+    unsigned int culled;    // instances outside the frustum
+    unsigned int draws;     // draw commands submitted
+    unsigned int drawsCulled; // draw commands dropped because all their instances were culled
+} cullStatsT;
+
+/**
+ * extract the frustum planes from a view-projection matrix
+ * @param VP projection * view
+ * @return normalised planes
+ */
+frustumT extractFrustum(const glm::mat4& VP);
+
+/**
+ * move a bounding sphere by a model matrix
+ * @param sphere xyz centre, w radius, in model coordinates
+ * @param model model matrix, may scale non-uniformly
+ * @return world sphere enclosing the transformed one
+ */
+glm::vec4 transformSphere(const glm::vec4& sphere, const glm::mat4& model);
+
+/**
+ * test bounding spheres against the frustum
+ * @param frustum planes from extractFrustum
+ * @param spheres xyz world centre, w radius
+ * @param count number of spheres
+ * @param visible set to 1 for spheres at least partly inside, 0 otherwise
+ * @return number of visible spheres
+ */
+int cullSpheres(const frustumT& frustum, const glm::vec4* spheres, int count, uint8_t* visible);
+
+#endif
@@ -0,0 +1,382 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Implementation of the scene geometry arena
+*/
+
+#include "geometry_arena.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+// instance attributes start here, one vec4 each (see StandardShading.vertexshader)
+const GLuint FIRST_INSTANCE_ATTRIBUTE = 3;
+const GLuint INSTANCE_ATTRIBUTES = sizeof(instanceDataT) / sizeof(glm::vec4);
+
+// float to IEEE half, rounded to nearest
+static uint16_t toHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+    int exponent = static_cast<int>((bits >> 23) & 0xffu) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffffu;
+    if (exponent >= 31) {
+        // too large, infinity or NaN
+        bool nan = ((bits >> 23) & 0xffu) == 0xffu && mantissa != 0;
+        return static_cast<uint16_t>(sign | 0x7c00u | (nan ? 0x200u : 0u));
+    }
+    if (exponent <= 0) {
+        // denormal or zero
+        if (exponent < -10) return sign;
+        mantissa |= 0x800000u;
+        uint32_t shift = static_cast<uint32_t>(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        if ((mantissa >> (shift - 1)) & 1u) half++;
+        return static_cast<uint16_t>(sign | half);
+    }
+    uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+    // round to nearest, a carry into the exponent is still correct
+    if (mantissa & 0x1000u) half++;
+    return static_cast<uint16_t>(sign | half);
+}
+
+static int16_t toSnorm16(float value) {
+    float clamped = std::max(-1.0f, std::min(1.0f, value));
+    return static_cast<int16_t>(std::lround(clamped * 32767.0f));
+}
+
+// unit vector onto the octahedron, folded into the [-1, 1] square
+static void encodeOctahedral(const glm::vec3& normal, int16_t out[2]) {
+    float sum = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+    if (sum <= 0.0f) {
+        out[0] = out[1] = 0;
+        return;
+    }
+    float x = normal.x / sum;
+    float y = normal.y / sum;
+    if (normal.z < 0.0f) {
+        float fx = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float fy = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = fx;
+        y = fy;
+    }
+    out[0] = toSnorm16(x);
+    out[1] = toSnorm16(y);
+}
+
+GeometryArena::GeometryArena(bool quantiseVertices)
+    : vertexArray(0), vertexbuffer(0), elementbuffer(0), indirectbuffer(0), instancebuffer(0),
+      longIndexCount(0), indirectCapacity(0), multiDraw(false), quantised(quantiseVertices) {
+    clear();
+}
+
+void GeometryArena::clear() {
+    std::vector<packedVertexT>().swap(vertices);
+    std::vector<quantisedVertexT>().swap(quantisedVertices);
+    std::vector<unsigned short>().swap(shortIndices);
+    std::vector<unsigned int>().swap(longIndices);
+    meshes.clear();
+    cachedVertices = NULL;
+    cachedVertexBytes = 0;
+    cachedLongIndices = NULL;
+    cachedLongCount = 0;
+    cachedShortIndices = NULL;
+    cachedShortCount = 0;
+}
+
+void GeometryArena::writeCache(MeshCacheWriter& writer) const {
+    writer.putValue(static_cast<uint8_t>(quantised));
+    // the meshes as added, upload moves the 16-bit ones behind the 32-bit indices again
+    writer.putArray(meshes);
+    if (quantised) {
+        writer.putArray(quantisedVertices);
+    } else {
+        writer.putArray(vertices);
+    }
+    writer.putArray(longIndices);
+    writer.putArray(shortIndices);
+}
+
+bool GeometryArena::readCache(MeshCacheReader& reader) {
+    if (!meshes.empty() || vertexArray != 0) return false;
+
+    uint8_t cachedQuantised = 0;
+    std::vector<arenaMeshT> cachedMeshes;
+    if (!reader.getValue(cachedQuantised) || (cachedQuantised != 0) != quantised || !reader.getArray(cachedMeshes)) {
+        return false;
+    }
+    size_t vertexCount = 0;
+    const void* vertexData = NULL;
+    if (quantised) {
+        const quantisedVertexT* first = NULL;
+        if (!reader.getSpan(first, vertexCount)) return false;
+        vertexData = first;
+    } else {
+        const packedVertexT* first = NULL;
+        if (!reader.getSpan(first, vertexCount)) return false;
+        vertexData = first;
+    }
+    const unsigned int* longData = NULL;
+    const unsigned short* shortData = NULL;
+    size_t longCount = 0, shortCount = 0;
+    if (!reader.getSpan(longData, longCount) || !reader.getSpan(shortData, shortCount)) return false;
+
+    // a damaged file must not send a draw outside the buffers
+    for (const arenaMeshT& mesh : cachedMeshes) {
+        bool wide = (mesh.indexType == GL_UNSIGNED_INT);
+        if ((!wide && mesh.indexType != GL_UNSIGNED_SHORT) || wide != (mesh.vertexCount > 65536) ||
+            mesh.baseVertex < 0 || static_cast<size_t>(mesh.baseVertex) > vertexCount ||
+            mesh.vertexCount > vertexCount - static_cast<size_t>(mesh.baseVertex) ||
+            mesh.indexCount % 3 != 0 || !(mesh.positionScale > 0.0f)) {
+            return false;
+        }
+        size_t sectionCount = wide ? longCount : shortCount;
+        if (mesh.firstIndex > sectionCount || mesh.indexCount > sectionCount - mesh.firstIndex) return false;
+        for (unsigned int i = mesh.firstIndex; i < mesh.firstIndex + mesh.indexCount; i++) {
+            unsigned int index = wide ? longData[i] : shortData[i];
+            if (index >= mesh.vertexCount) return false;
+        }
+    }
+
+    meshes.swap(cachedMeshes);
+    cachedVertices = vertexData;
+    cachedVertexBytes = vertexCount * vertexSize();
+    cachedLongIndices = longData;
+    cachedLongCount = longCount;
+    cachedShortIndices = shortData;
+    cachedShortCount = shortCount;
+    return true;
+}
+
+int GeometryArena::addMesh(const std::vector<packedVertexT>& meshVertices,
+                           const std::vector<unsigned int>& meshIndices) {
+    arenaMeshT mesh;
+    mesh.vertexCount = static_cast<unsigned int>(meshVertices.size());
+    // indices are relative to the mesh's base vertex, so 16 bits are enough unless this
+    // one mesh is larger than that
+    mesh.indexType = (mesh.vertexCount > 65536) ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+    mesh.positionOffset = glm::vec3(0.0f);
+    mesh.positionScale = 1.0f;
+    if (!quantised) {
+        mesh.baseVertex = static_cast<int>(vertices.size());
+        vertices.insert(vertices.end(), meshVertices.begin(), meshVertices.end());
+    } else {
+        mesh.baseVertex = static_cast<int>(quantisedVertices.size());
+        // one scale for all three axes keeps the model matrix free of non-uniform
+        // scaling, so normals and bounding spheres transform as before
+        glm::vec3 low(0.0f), high(0.0f);
+        if (!meshVertices.empty()) low = high = meshVertices.front().position;
+        for (const auto& v : meshVertices) {
+            low = glm::min(low, v.position);
+            high = glm::max(high, v.position);
+        }
+        glm::vec3 extent = high - low;
+        float scale = std::max(extent.x, std::max(extent.y, extent.z));
+        if (scale <= 0.0f) scale = 1.0f;
+        mesh.positionOffset = low;
+        mesh.positionScale = scale;
+
+        for (const auto& v : meshVertices) {
+            quantisedVertexT q;
+            glm::vec3 p = (v.position - low) * (1.0f / scale);
+            q.position[0] = static_cast<uint16_t>(std::lround(std::min(1.0f, std::max(0.0f, p.x)) * 65535.0f));
+            q.position[1] = static_cast<uint16_t>(std::lround(std::min(1.0f, std::max(0.0f, p.y)) * 65535.0f));
+            q.position[2] = static_cast<uint16_t>(std::lround(std::min(1.0f, std::max(0.0f, p.z)) * 65535.0f));
+            q.position[3] = 0;
+            q.uv[0] = toHalf(v.uv.x);
+            q.uv[1] = toHalf(v.uv.y);
+            encodeOctahedral(v.normal, q.normal);
+            quantisedVertices.push_back(q);
+        }
+    }
+    appendIndices(mesh, meshIndices);
+    meshes.push_back(mesh);
+    return static_cast<int>(meshes.size()) - 1;
+}
+
+int GeometryArena::addLod(int mesh, const std::vector<unsigned int>& meshIndices) {
+    // same vertices and index type, its own range of indices
+    arenaMeshT lod = meshes[mesh];
+    appendIndices(lod, meshIndices);
+    meshes.push_back(lod);
+    return static_cast<int>(meshes.size()) - 1;
+}
+
+// until upload, firstIndex counts from the start of the mesh's own index list
+void GeometryArena::appendIndices(arenaMeshT& mesh, const std::vector<unsigned int>& meshIndices) {
+    mesh.indexCount = static_cast<unsigned int>(meshIndices.size());
+    if (mesh.indexType == GL_UNSIGNED_INT) {
+        mesh.firstIndex = static_cast<unsigned int>(longIndices.size());
+        longIndices.insert(longIndices.end(), meshIndices.begin(), meshIndices.end());
+    } else {
+        mesh.firstIndex = static_cast<unsigned int>(shortIndices.size());
+        shortIndices.insert(shortIndices.end(), meshIndices.begin(), meshIndices.end());
+    }
+}
+
+bool GeometryArena::upload(GLuint instanceBuffer) {
+    instancebuffer = instanceBuffer;
+    multiDraw = GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance;
+
+    // the buffers as packed here, or as they lie in the mapped mesh cache
+    const void* vertexData = quantised ? static_cast<const void*>(quantisedVertices.data()) : vertices.data();
+    size_t vertexBytes = quantised ? quantisedVertices.size() * sizeof(quantisedVertexT) : vertices.size() * sizeof(packedVertexT);
+    const unsigned int* longData = longIndices.data();
+    size_t longCount = longIndices.size();
+    const unsigned short* shortData = shortIndices.data();
+    size_t shortCount = shortIndices.size();
+    if (cachedVertices != NULL) {
+        vertexData = cachedVertices;
+        vertexBytes = cachedVertexBytes;
+        longData = cachedLongIndices;
+        longCount = cachedLongCount;
+        shortData = cachedShortIndices;
+        shortCount = cachedShortCount;
+    }
+
+    // the 16-bit indices follow the 32-bit ones; 4 bytes of those are 2 of these
+    longIndexCount = static_cast<unsigned int>(longCount);
+    for (auto& mesh : meshes) {
+        if (mesh.indexType == GL_UNSIGNED_SHORT) mesh.firstIndex += 2 * longIndexCount;
+    }
+
+    glGenVertexArrays(1, &vertexArray);
+    glBindVertexArray(vertexArray);
+
+    glGenBuffers(1, &vertexbuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
+    size_t vertexTotal = vertexBytes / vertexSize();
+    glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertexData, GL_STATIC_DRAW);
+    if (!quantised) {
+
+        // Attributes 0-2 : position, UV and normal, interleaved
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(packedVertexT), (void*)offsetof(packedVertexT, position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(packedVertexT), (void*)offsetof(packedVertexT, uv));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(packedVertexT), (void*)offsetof(packedVertexT, normal));
+    } else {
+        // Same attributes, normalised integers and half floats; the model matrix scales
+        // the position back and the shader unfolds the normal
+        GLsizei stride = sizeof(quantisedVertexT);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(quantisedVertexT, position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(quantisedVertexT, uv));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(quantisedVertexT, normal));
+    }
+
+    // Index buffer, also part of the VAO
+    glGenBuffers(1, &elementbuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementbuffer);
+    size_t longBytes = longCount * sizeof(unsigned int);
+    size_t shortBytes = shortCount * sizeof(unsigned short);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, longBytes + shortBytes, NULL, GL_STATIC_DRAW);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, longBytes, longData);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, longBytes, shortBytes, shortData);
+
+    setInstanceAttributes(0);
+    glBindVertexArray(0);
+
+    if (multiDraw) {
+        glGenBuffers(1, &indirectbuffer);
+    }
+
+    std::cout << meshes.size() << " meshes packed into one arena: " << vertexTotal << " vertices ("
+              << vertexBytes << " bytes), " << shortCount << " 16-bit and " << longCount << " 32-bit indices"
+              << (quantised ? ", quantised" : "") << (cachedVertices != NULL ? ", from the mesh cache" : "")
+              << (multiDraw ? ", multi-draw indirect" : "") << std::endl;
+
+    // the GPU has its own copy now, keep only the mesh table
+    std::vector<arenaMeshT> uploaded;
+    uploaded.swap(meshes);
+    clear();
+    meshes.swap(uploaded);
+    return vertexbuffer != 0 && elementbuffer != 0;
+}
+
+void GeometryArena::destroy() {
+    glDeleteBuffers(1, &vertexbuffer);
+    glDeleteBuffers(1, &elementbuffer);
+    glDeleteBuffers(1, &indirectbuffer);
+    glDeleteVertexArrays(1, &vertexArray);
+    vertexbuffer = elementbuffer = indirectbuffer = vertexArray = 0;
+    indirectCapacity = 0;
+}
+
+void GeometryArena::setInstanceBuffer(GLuint instanceBuffer) {
+    instancebuffer = instanceBuffer;
+    glBindVertexArray(vertexArray);
+    setInstanceAttributes(0);
+    glBindVertexArray(0);
+}
+
+void GeometryArena::setInstanceAttributes(unsigned int firstInstance) {
+    // motion, model matrix, MVP and material, all advancing once per instance
+    glBindBuffer(GL_ARRAY_BUFFER, instancebuffer);
+    for (GLuint i = 0; i < INSTANCE_ATTRIBUTES; i++) {
+        glEnableVertexAttribArray(FIRST_INSTANCE_ATTRIBUTE + i);
+        glVertexAttribPointer(FIRST_INSTANCE_ATTRIBUTE + i, 4, GL_FLOAT, GL_FALSE, sizeof(instanceDataT),
+                              (void*)(firstInstance * sizeof(instanceDataT) + i * sizeof(glm::vec4)));
+        glVertexAttribDivisor(FIRST_INSTANCE_ATTRIBUTE + i, 1);
+    }
+}
+
+drawCommandT GeometryArena::makeCommand(int mesh, unsigned int count, unsigned int baseInstance) const {
+    drawCommandT command;
+    command.count = meshes[mesh].indexCount;
+    command.instanceCount = count;
+    command.firstIndex = meshes[mesh].firstIndex;
+    command.baseVertex = meshes[mesh].baseVertex;
+    command.baseInstance = baseInstance;
+    return command;
+}
+
+unsigned int GeometryArena::draw(const drawCommandT* commands, unsigned int count) {
+    if (count == 0) return 0;
+    glBindVertexArray(vertexArray);
+
+    if (multiDraw) {
+        // the whole list in one upload, one call per run of the same index type; the
+        // run split keeps the order, the fading pieces still draw last
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectbuffer);
+        if (count > indirectCapacity) indirectCapacity = count;
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, indirectCapacity * sizeof(drawCommandT), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, count * sizeof(drawCommandT), commands);
+        unsigned int calls = 0;
+        unsigned int first = 0;
+        while (first < count) {
+            GLenum type = commandIndexType(commands[first]);
+            unsigned int last = first + 1;
+            while (last < count && commandIndexType(commands[last]) == type) last++;
+            glMultiDrawElementsIndirect(GL_TRIANGLES, type, (void*)(first * sizeof(drawCommandT)), last - first,
+                                        sizeof(drawCommandT));
+            calls++;
+            first = last;
+        }
+        return calls;
+    }
+
+    // GL 3.3: one base-vertex draw per command
+    for (unsigned int c = 0; c < count; c++) {
+        const drawCommandT& cmd = commands[c];
+        GLenum indexType = commandIndexType(cmd);
+        size_t indexSize = (indexType == GL_UNSIGNED_SHORT) ? sizeof(unsigned short) : sizeof(unsigned int);
+        void* offset = (void*)(cmd.firstIndex * indexSize);
+        if (GLEW_ARB_base_instance) {
+            glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, cmd.count, indexType, offset,
+                                                          cmd.instanceCount, cmd.baseVertex, cmd.baseInstance);
+        } else {
+            // no base instance either, move the instance attributes instead
+            setInstanceAttributes(cmd.baseInstance);
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, cmd.count, indexType, offset,
+                                              cmd.instanceCount, cmd.baseVertex);
+        }
+    }
+    return count;
+}
@@ -0,0 +1,139 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Scene geometry arena. Every board and piece mesh is packed into one vertex
+buffer and one index buffer, each mesh addressed by its first index and base vertex, behind
+a single VAO. Indices are 16-bit for every mesh that fits and 32-bit only for meshes over
+65536 vertices; the 32-bit ones go first in the index buffer and the 16-bit ones after them.
+A frame is then submitted as a list of indirect draw commands: one glMultiDrawElementsIndirect
+call per run of commands with the same index type where the driver supports it, and a loop
+of base-vertex draws on plain GL 3.3. Vertices can optionally be stored quantised (quantisedVertexT): each
+mesh's positions are scaled into its bounding box, and that offset and scale go into the
+mesh's model matrix instead of the shader.
+*/
+
+#ifndef GEOMETRY_ARENA_H
+#define GEOMETRY_ARENA_H
+
+#include <vector>
+#include <GL/glew.h>
+#include "chessCommon.h"
+#include "mesh_cache.h"
+
+// Same layout as DrawElementsIndirectCommand
+typedef struct
+{
+    GLuint count;           // indices per instance
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;    // first instance record in the instance buffer
+} drawCommandT;
+
+// Where one mesh lives in the arena
+typedef struct
+{
+    unsigned int firstIndex;
+    unsigned int indexCount;
+    int baseVertex;
+    unsigned int vertexCount;
+    GLenum indexType;       // GL_UNSIGNED_SHORT, or GL_UNSIGNED_INT over 65536 vertices
+    // stored position * positionScale + positionOffset gives the mesh's own coordinates
+    glm::vec3 positionOffset;
+    float positionScale;
+} arenaMeshT;
+
+class GeometryArena {
+private:
+    // CPU copy, released once uploaded; one of the vertex lists is used
+    std::vector<packedVertexT> vertices;
+    std::vector<quantisedVertexT> quantisedVertices;
+    std::vector<unsigned short> shortIndices;
+    std::vector<unsigned int> longIndices;
+    std::vector<arenaMeshT> meshes;
+    // Buffers left in the mapped mesh cache, uploaded from there instead of the lists above
+    const void* cachedVertices;
+    size_t cachedVertexBytes;
+    const unsigned int* cachedLongIndices;
+    size_t cachedLongCount;
+    const unsigned short* cachedShortIndices;
+    size_t cachedShortCount;
+
+    GLuint vertexArray;
+    GLuint vertexbuffer;
+    GLuint elementbuffer;
+    GLuint indirectbuffer;
+    GLuint instancebuffer;
+    unsigned int longIndexCount;    // 32-bit indices at the start of the index buffer
+    unsigned int indirectCapacity;  // commands the indirect buffer holds
+    bool multiDraw;                 // glMultiDrawElementsIndirect is available
+    bool quantised;                 // vertices stored as quantisedVertexT
+
+    void setInstanceAttributes(unsigned int firstInstance);
+    void appendIndices(arenaMeshT& mesh, const std::vector<unsigned int>& meshIndices);
+    // the 32-bit indices come first, so a command's first index tells its type
+    GLenum commandIndexType(const drawCommandT& command) const {
+        return command.firstIndex < longIndexCount ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+    }
+
+public:
+    /**
+     * @param quantiseVertices store 16-byte quantised vertices instead of 32-byte float ones;
+     * the vertex shader must then decode octahedral normals
+     */
+    explicit GeometryArena(bool quantiseVertices = false);
+
+    /**
+     * append a mesh; indices are relative to its own first vertex
+     * @return arena mesh id
+     */
+    int addMesh(const std::vector<packedVertexT>& meshVertices, const std::vector<unsigned int>& meshIndices);
+
+    /**
+     * append another index list over the vertices of a mesh, e.g. a level of detail
+     * @param mesh arena mesh whose vertices the indices refer to
+     * @param meshIndices triangles, relative to the mesh's first vertex
+     * @return arena mesh id
+     */
+    int addLod(int mesh, const std::vector<unsigned int>& meshIndices);
+
+    /**
+     * create the GL buffers and the VAO, reading instances from the given buffer
+     * @param instanceBuffer buffer holding instanceDataT records
+     * @return true on success
+     */
+    bool upload(GLuint instanceBuffer);
+    void destroy();
+    // read instances from another buffer, e.g. after the instance ring grew
+    void setInstanceBuffer(GLuint instanceBuffer);
+    // forget every mesh added, before upload
+    void clear();
+
+    // write the meshes and their buffers, exactly as upload sends them, to the mesh cache
+    void writeCache(MeshCacheWriter& writer) const;
+    /**
+     * take the meshes from the mesh cache into an empty arena; the buffers stay in the
+     * mapping, which must outlive upload. Every mesh is checked to stay inside the buffers.
+     * @return false if the record is incomplete, inconsistent or of the other vertex format
+     */
+    bool readCache(MeshCacheReader& reader);
+
+    unsigned int meshCount() const { return static_cast<unsigned int>(meshes.size()); }
+    bool isQuantised() const { return quantised; }
+    // bytes per vertex on the GPU
+    size_t vertexSize() const { return quantised ? sizeof(quantisedVertexT) : sizeof(packedVertexT); }
+    const arenaMeshT& getMesh(int mesh) const { return meshes[mesh]; }
+
+    // command drawing count instances of a mesh, starting at record baseInstance
+    drawCommandT makeCommand(int mesh, unsigned int count, unsigned int baseInstance) const;
+
+    /**
+     * draw a list of commands in order; with multi-draw, each run of commands sharing an
+     * index type is one call
+     * @return number of GL draw calls issued
+     */
+    unsigned int draw(const drawCommandT* commands, unsigned int count);
+};
+
+#endif
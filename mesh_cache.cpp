@@ -0,0 +1,134 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Implementation of the binary mesh cache
+*/
+
+#include "mesh_cache.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "chessComponent.h"
+#include "geometry_arena.h"
+
+const char MESH_CACHE_MAGIC[4] = { 'C', 'M', 'S', 'H' };
+
+// Size and modification time of a source; the cache is stale once either changes
+static bool sourceStamp(const std::string& path, uint64_t& size, int64_t& modified) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) return false;
+    size = static_cast<uint64_t>(info.st_size);
+    modified = static_cast<int64_t>(info.st_mtime);
+    return true;
+}
+
+bool MeshCache::load(const char* cachePath, const std::vector<std::string>& sources,
+                     std::vector<chessComponent>& components, GeometryArena& arena) {
+    close();
+    auto start = std::chrono::steady_clock::now();
+    int fd = open(cachePath, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+    mappedSize = static_cast<size_t>(info.st_size);
+    mapped = mmap(NULL, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        mapped = NULL;
+        mappedSize = 0;
+        return false;
+    }
+
+    MeshCacheReader reader(static_cast<const unsigned char*>(mapped), mappedSize);
+    char magic[4];
+    uint32_t version = 0, sourceCount = 0;
+    bool current = reader.get(magic, sizeof(magic)) && memcmp(magic, MESH_CACHE_MAGIC, sizeof(magic)) == 0 &&
+                   reader.getValue(version) && version == MESH_CACHE_VERSION &&
+                   reader.getValue(sourceCount) && sourceCount == sources.size();
+    for (size_t s = 0; current && s < sources.size(); s++) {
+        std::string path;
+        uint64_t cachedSize = 0, sourceSize = 0;
+        int64_t cachedModified = 0, sourceModified = 0;
+        current = reader.getString(path) && reader.getValue(cachedSize) && reader.getValue(cachedModified) &&
+                  path == sources[s] && sourceStamp(sources[s], sourceSize, sourceModified) &&
+                  cachedSize == sourceSize && cachedModified == sourceModified;
+    }
+
+    // the components are read in place, and dropped again with the arena if the file
+    // turns out short or inconsistent
+    uint32_t count = 0;
+    size_t first = components.size();
+    current = current && arena.readCache(reader) && reader.getValue(count);
+    if (current) {
+        components.resize(first + count);
+        for (size_t c = first; current && c < components.size(); c++) {
+            current = components[c].readCache(reader, arena);
+        }
+        current = current && reader.atEnd();
+    }
+
+    if (!current) {
+        components.resize(first);
+        arena.clear();
+        close();
+        std::cout << "Mesh cache " << cachePath << " is missing or stale, loading the OBJ files" << std::endl;
+        return false;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << "Mapped " << count << " meshes from " << cachePath << " in " << elapsed.count() << " ms" << std::endl;
+    return true;
+}
+
+void MeshCache::close() {
+    if (mapped) munmap(mapped, mappedSize);
+    mapped = NULL;
+    mappedSize = 0;
+}
+
+bool writeMeshCache(const char* cachePath, const std::vector<std::string>& sources,
+                    const std::vector<chessComponent>& components, const GeometryArena& arena) {
+    MeshCacheWriter writer;
+    writer.put(MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+    writer.putValue(MESH_CACHE_VERSION);
+    writer.putValue(static_cast<uint32_t>(sources.size()));
+    for (const std::string& source : sources) {
+        uint64_t size = 0;
+        int64_t modified = 0;
+        if (!sourceStamp(source, size, modified)) return false;
+        writer.putString(source);
+        writer.putValue(size);
+        writer.putValue(modified);
+    }
+    arena.writeCache(writer);
+    writer.putValue(static_cast<uint32_t>(components.size()));
+    for (const chessComponent& component : components) {
+        component.writeCache(writer);
+    }
+
+    // written next to the cache and renamed over it, a failed write leaves no half file
+    std::string temporary = std::string(cachePath) + ".tmp";
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if (!file) {
+        std::cout << "Mesh cache " << cachePath << " could not be written" << std::endl;
+        return false;
+    }
+    const std::vector<unsigned char>& data = writer.getData();
+    bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+    written = (fclose(file) == 0) && written;
+    if (!written || rename(temporary.c_str(), cachePath) != 0) {
+        remove(temporary.c_str());
+        std::cout << "Mesh cache " << cachePath << " could not be written" << std::endl;
+        return false;
+    }
+    std::cout << "Wrote " << components.size() << " meshes to " << cachePath << ", "
+              << data.size() / 1024 << " KB" << std::endl;
+    return true;
+}
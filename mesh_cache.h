@@ -0,0 +1,158 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Binary cache of the loaded chess meshes. The first launch parses the OBJ files
+through Assimp, optimises the meshes, builds their levels of detail and packs them into the
+scene arena, then writes the arena's buffers exactly as they go to the GPU (quantised
+vertices, 16 and 32-bit index streams) together with every component's placement in them,
+to one versioned file stamped with the size and modification time of every OBJ and MTL
+file. Later launches mmap that file and the arena uploads its buffers straight from the
+mapping; Assimp only runs again when a source changed or the format version moved on.
+*/
+
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Bump whenever the record layout or the mesh processing behind it changes
+const uint32_t MESH_CACHE_VERSION = 3;
+// Arrays start on this boundary in the file, so the mapping can be used in place
+const size_t MESH_CACHE_ALIGNMENT = 8;
+
+class chessComponent;
+class GeometryArena;
+
+// Appends the values of a cache file in memory
+class MeshCacheWriter {
+private:
+    std::vector<unsigned char> data;
+
+public:
+    void put(const void* bytes, size_t size) {
+        const unsigned char* first = static_cast<const unsigned char*>(bytes);
+        data.insert(data.end(), first, first + size);
+    }
+    template <typename T>
+    void putValue(const T& value) { put(&value, sizeof(T)); }
+    void putString(const std::string& text) {
+        putValue(static_cast<uint32_t>(text.size()));
+        put(text.data(), text.size());
+    }
+    // count first, then padding to the alignment and the elements as they are in memory
+    template <typename T>
+    void putArray(const T* values, size_t count) {
+        putValue(static_cast<uint64_t>(count));
+        data.resize((data.size() + MESH_CACHE_ALIGNMENT - 1) / MESH_CACHE_ALIGNMENT * MESH_CACHE_ALIGNMENT, 0);
+        put(values, count * sizeof(T));
+    }
+    template <typename T>
+    void putArray(const std::vector<T>& values) { putArray(values.data(), values.size()); }
+    const std::vector<unsigned char>& getData() const { return data; }
+};
+
+// Reads the values back from the mapped file; any read past the end fails this and every
+// later read
+class MeshCacheReader {
+private:
+    const unsigned char* begin;
+    const unsigned char* cursor;
+    const unsigned char* end;
+    bool valid;
+
+    bool align() {
+        size_t offset = static_cast<size_t>(cursor - begin);
+        size_t padding = (MESH_CACHE_ALIGNMENT - offset % MESH_CACHE_ALIGNMENT) % MESH_CACHE_ALIGNMENT;
+        if (!valid || static_cast<size_t>(end - cursor) < padding) return valid = false;
+        cursor += padding;
+        return true;
+    }
+
+public:
+    // data must be aligned to MESH_CACHE_ALIGNMENT, as a mapping is
+    MeshCacheReader(const unsigned char* data, size_t size)
+        : begin(data), cursor(data), end(data + size), valid(true) {}
+
+    bool get(void* bytes, size_t size) {
+        if (!valid || static_cast<size_t>(end - cursor) < size) {
+            valid = false;
+            return false;
+        }
+        if (size > 0) memcpy(bytes, cursor, size);
+        cursor += size;
+        return true;
+    }
+    template <typename T>
+    bool getValue(T& value) { return get(&value, sizeof(T)); }
+    bool getString(std::string& text) {
+        uint32_t size = 0;
+        if (!getValue(size) || static_cast<size_t>(end - cursor) < size) return valid = false;
+        text.assign(reinterpret_cast<const char*>(cursor), size);
+        cursor += size;
+        return true;
+    }
+    // an array left where it is in the file, valid as long as the data is
+    template <typename T>
+    bool getSpan(const T*& values, size_t& count) {
+        uint64_t size = 0;
+        if (!getValue(size) || !align() || size > static_cast<uint64_t>(end - cursor) / sizeof(T)) {
+            return valid = false;
+        }
+        values = reinterpret_cast<const T*>(cursor);
+        count = static_cast<size_t>(size);
+        cursor += count * sizeof(T);
+        return true;
+    }
+    template <typename T>
+    bool getArray(std::vector<T>& values) {
+        const T* first = NULL;
+        size_t count = 0;
+        if (!getSpan(first, count)) return false;
+        values.assign(first, first + count);
+        return true;
+    }
+    bool ok() const { return valid; }
+    bool atEnd() const { return cursor == end; }
+};
+
+// The mapped cache file; the arena reads its buffers from the mapping until it has uploaded them
+class MeshCache {
+private:
+    void* mapped;
+    size_t mappedSize;
+
+public:
+    MeshCache() : mapped(NULL), mappedSize(0) {}
+    ~MeshCache() { close(); }
+
+    /**
+     * map the cache and restore the arena and the components if it is current for the sources
+     * @param cachePath cache file
+     * @param sources OBJ and MTL files the cache was built from, in load order
+     * @param components receives the components, left as it was on failure
+     * @param arena empty scene arena, takes its meshes and buffers from the mapping
+     * @return true if the cache was current and complete; keep the cache open until the
+     * arena is uploaded
+     */
+    bool load(const char* cachePath, const std::vector<std::string>& sources,
+              std::vector<chessComponent>& components, GeometryArena& arena);
+    // unmap the file, once the arena has uploaded
+    void close();
+};
+
+/**
+ * write the components and the arena they are packed into, set up but not yet uploaded
+ * @param cachePath cache file
+ * @param sources OBJ and MTL files the components were loaded from, in load order
+ * @param components components to store
+ * @param arena scene arena holding their geometry
+ * @return true if the whole file was written
+ */
+bool writeMeshCache(const char* cachePath, const std::vector<std::string>& sources,
+                    const std::vector<chessComponent>& components, const GeometryArena& arena);
+
+#endif
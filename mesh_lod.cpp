@@ -0,0 +1,351 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Implementation of mesh simplification and level of detail selection
+*/
+
+#include "mesh_lod.h"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+
+// Border edges are held by a plane through them, this much heavier than a face
+const double BORDER_WEIGHT = 10.0;
+// Cosine of the largest turn a collapse may give a triangle's normal
+const double MAX_NORMAL_TURN = 0.25;
+
+// Symmetric 4x4 error quadric, upper triangle
+typedef struct
+{
+    double a00, a01, a02, a03, a11, a12, a13, a22, a23, a33;
+} quadricT;
+
+void addPlane(quadricT& q, double a, double b, double c, double d, double weight) {
+    q.a00 += weight * a * a; q.a01 += weight * a * b; q.a02 += weight * a * c; q.a03 += weight * a * d;
+    q.a11 += weight * b * b; q.a12 += weight * b * c; q.a13 += weight * b * d;
+    q.a22 += weight * c * c; q.a23 += weight * c * d;
+    q.a33 += weight * d * d;
+}
+
+void addQuadric(quadricT& q, const quadricT& r) {
+    q.a00 += r.a00; q.a01 += r.a01; q.a02 += r.a02; q.a03 += r.a03;
+    q.a11 += r.a11; q.a12 += r.a12; q.a13 += r.a13;
+    q.a22 += r.a22; q.a23 += r.a23;
+    q.a33 += r.a33;
+}
+
+// squared distance to the planes of q, weighted
+double evaluate(const quadricT& q, const glm::vec3& p) {
+    double x = p.x, y = p.y, z = p.z;
+    return q.a00 * x * x + 2.0 * q.a01 * x * y + 2.0 * q.a02 * x * z + 2.0 * q.a03 * x
+         + q.a11 * y * y + 2.0 * q.a12 * y * z + 2.0 * q.a13 * y
+         + q.a22 * z * z + 2.0 * q.a23 * z
+         + q.a33;
+}
+
+// Moving every vertex at one position onto the position of a neighbour
+typedef struct
+{
+    double cost;
+    unsigned int from, to;
+    unsigned int fromVersion, toVersion;    // stale once either position changed
+} collapseT;
+
+struct cheaperFirst {
+    bool operator()(const collapseT& a, const collapseT& b) const { return a.cost > b.cost; }
+};
+
+// Vertices are welded by position; UV and normal seams keep several vertices per position
+struct positionKey {
+    uint32_t x, y, z;
+    bool operator==(const positionKey& o) const { return x == o.x && y == o.y && z == o.z; }
+};
+
+struct positionKeyHash {
+    size_t operator()(const positionKey& k) const {
+        return static_cast<size_t>((k.x * 73856093u) ^ (k.y * 19349663u) ^ (k.z * 83492791u));
+    }
+};
+
+positionKey makeKey(const glm::vec3& p) {
+    positionKey key;
+    std::memcpy(&key.x, &p.x, sizeof(uint32_t));
+    std::memcpy(&key.y, &p.y, sizeof(uint32_t));
+    std::memcpy(&key.z, &p.z, sizeof(uint32_t));
+    return key;
+}
+
+uint64_t edgeKey(unsigned int a, unsigned int b) {
+    if (a > b) std::swap(a, b);
+    return (static_cast<uint64_t>(a) << 32) | b;
+}
+
+class Simplifier {
+private:
+    const std::vector<glm::vec3>& positions;
+    std::vector<unsigned int> tris;
+    std::vector<bool> triAlive;
+    std::vector<std::vector<unsigned int>> vertexTris;  // triangles using each vertex, may list dead ones
+
+    // one entry per welded position
+    std::vector<unsigned int> group;                    // vertex -> position
+    std::vector<std::vector<unsigned int>> wedges;      // position -> its vertices
+    std::vector<glm::vec3> groupPos;
+    std::vector<quadricT> quadrics;
+    std::vector<unsigned int> version;
+    std::vector<bool> groupAlive;
+    std::vector<unsigned int> seen;
+    unsigned int seenStamp;
+
+    std::priority_queue<collapseT, std::vector<collapseT>, cheaperFirst> heap;
+    size_t liveIndices;
+
+    bool distinct(unsigned int t) const {
+        unsigned int g0 = group[tris[3 * t]], g1 = group[tris[3 * t + 1]], g2 = group[tris[3 * t + 2]];
+        return g0 != g1 && g1 != g2 && g0 != g2;
+    }
+
+    void push(unsigned int from, unsigned int to) {
+        quadricT q = quadrics[from];
+        addQuadric(q, quadrics[to]);
+        collapseT c;
+        c.cost = evaluate(q, groupPos[to]);
+        c.from = from;
+        c.to = to;
+        c.fromVersion = version[from];
+        c.toVersion = version[to];
+        heap.push(c);
+    }
+
+    bool tryCollapse(unsigned int from, unsigned int to);
+
+public:
+    Simplifier(const std::vector<glm::vec3>& vertexPositions, const std::vector<unsigned int>& indices);
+    std::vector<unsigned int> run(size_t targetIndexCount);
+};
+
+Simplifier::Simplifier(const std::vector<glm::vec3>& vertexPositions, const std::vector<unsigned int>& indices)
+    : positions(vertexPositions), tris(indices), seenStamp(0), liveIndices(0) {
+    size_t triCount = tris.size() / 3;
+    tris.resize(triCount * 3);
+    triAlive.assign(triCount, true);
+    vertexTris.resize(positions.size());
+
+    // weld
+    std::unordered_map<positionKey, unsigned int, positionKeyHash> weld;
+    group.resize(positions.size());
+    for (size_t v = 0; v < positions.size(); v++) {
+        auto it = weld.find(makeKey(positions[v]));
+        if (it == weld.end()) {
+            unsigned int g = static_cast<unsigned int>(groupPos.size());
+            weld[makeKey(positions[v])] = g;
+            groupPos.push_back(positions[v]);
+            wedges.push_back(std::vector<unsigned int>());
+            group[v] = g;
+        } else {
+            group[v] = it->second;
+        }
+        wedges[group[v]].push_back(static_cast<unsigned int>(v));
+    }
+    size_t groups = groupPos.size();
+    quadricT zero;
+    std::memset(&zero, 0, sizeof(zero));
+    quadrics.assign(groups, zero);
+    version.assign(groups, 0);
+    groupAlive.assign(groups, true);
+    seen.assign(groups, 0);
+
+    // face planes, weighted by area, and the edges each position pair is used by
+    std::unordered_map<uint64_t, std::pair<int, unsigned int>> edges;
+    for (size_t t = 0; t < triCount; t++) {
+        if (!distinct(static_cast<unsigned int>(t))) {
+            triAlive[t] = false;
+            continue;
+        }
+        liveIndices += 3;
+        const glm::vec3& p0 = groupPos[group[tris[3 * t]]];
+        const glm::vec3& p1 = groupPos[group[tris[3 * t + 1]]];
+        const glm::vec3& p2 = groupPos[group[tris[3 * t + 2]]];
+        glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+        double length = std::sqrt(static_cast<double>(glm::dot(n, n)));
+        for (int c = 0; c < 3; c++) {
+            vertexTris[tris[3 * t + c]].push_back(static_cast<unsigned int>(t));
+            uint64_t key = edgeKey(group[tris[3 * t + c]], group[tris[3 * t + (c + 1) % 3]]);
+            auto& edge = edges[key];
+            edge.first++;
+            edge.second = static_cast<unsigned int>(t);
+        }
+        if (length <= 0.0) continue;
+        double a = n.x / length, b = n.y / length, c = n.z / length;
+        double d = -(a * p0.x + b * p0.y + c * p0.z);
+        for (int k = 0; k < 3; k++) {
+            addPlane(quadrics[group[tris[3 * t + k]]], a, b, c, d, 0.5 * length);
+        }
+    }
+
+    // open borders: a plane along the edge, at right angles to its triangle
+    for (const auto& edge : edges) {
+        if (edge.second.first != 1) continue;
+        unsigned int ga = static_cast<unsigned int>(edge.first >> 32);
+        unsigned int gb = static_cast<unsigned int>(edge.first & 0xffffffffu);
+        unsigned int t = edge.second.second;
+        const glm::vec3& p0 = groupPos[group[tris[3 * t]]];
+        glm::vec3 faceNormal = glm::cross(groupPos[group[tris[3 * t + 1]]] - p0, groupPos[group[tris[3 * t + 2]]] - p0);
+        glm::vec3 along = groupPos[gb] - groupPos[ga];
+        glm::vec3 n = glm::cross(along, faceNormal);
+        double length = std::sqrt(static_cast<double>(glm::dot(n, n)));
+        if (length <= 0.0) continue;
+        double a = n.x / length, b = n.y / length, c = n.z / length;
+        double d = -(a * groupPos[ga].x + b * groupPos[ga].y + c * groupPos[ga].z);
+        double weight = BORDER_WEIGHT * glm::dot(along, along);
+        addPlane(quadrics[ga], a, b, c, d, weight);
+        addPlane(quadrics[gb], a, b, c, d, weight);
+    }
+
+    // every edge, both ways
+    for (const auto& edge : edges) {
+        unsigned int ga = static_cast<unsigned int>(edge.first >> 32);
+        unsigned int gb = static_cast<unsigned int>(edge.first & 0xffffffffu);
+        push(ga, gb);
+        push(gb, ga);
+    }
+}
+
+bool Simplifier::tryCollapse(unsigned int from, unsigned int to) {
+    // every vertex at the old position needs a vertex at the new one it shares an edge with;
+    // one on a seam that only meets the new position from one side would tear the seam
+    std::vector<unsigned int> target(wedges[from].size());
+    for (size_t w = 0; w < wedges[from].size(); w++) {
+        unsigned int u = wedges[from][w];
+        bool used = false;
+        bool found = false;
+        for (unsigned int t : vertexTris[u]) {
+            if (!triAlive[t]) continue;
+            used = true;
+            for (int c = 0; c < 3 && !found; c++) {
+                if (group[tris[3 * t + c]] == to) {
+                    target[w] = tris[3 * t + c];
+                    found = true;
+                }
+            }
+            if (found) break;
+        }
+        if (!used) target[w] = wedges[to].front();
+        else if (!found) return false;
+    }
+
+    // the triangles that survive may not fold over
+    for (unsigned int u : wedges[from]) {
+        for (unsigned int t : vertexTris[u]) {
+            if (!triAlive[t]) continue;
+            glm::vec3 before[3], after[3];
+            bool dies = false;
+            for (int c = 0; c < 3; c++) {
+                unsigned int g = group[tris[3 * t + c]];
+                if (g == to) dies = true;
+                before[c] = groupPos[g];
+                after[c] = (g == from) ? groupPos[to] : groupPos[g];
+            }
+            if (dies) continue;
+            glm::vec3 n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+            glm::vec3 n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+            double l0 = std::sqrt(static_cast<double>(glm::dot(n0, n0)));
+            double l1 = std::sqrt(static_cast<double>(glm::dot(n1, n1)));
+            if (l0 <= 0.0) continue;
+            if (glm::dot(n0, n1) < MAX_NORMAL_TURN * l0 * l1) return false;
+        }
+    }
+
+    // move the triangles over, dropping the ones that collapse
+    for (size_t w = 0; w < wedges[from].size(); w++) {
+        unsigned int u = wedges[from][w];
+        for (unsigned int t : vertexTris[u]) {
+            if (!triAlive[t]) continue;
+            for (int c = 0; c < 3; c++) {
+                if (tris[3 * t + c] == u) tris[3 * t + c] = target[w];
+            }
+            if (!distinct(t)) {
+                triAlive[t] = false;
+                liveIndices -= 3;
+            } else {
+                vertexTris[target[w]].push_back(t);
+            }
+        }
+        vertexTris[u].clear();
+    }
+    addQuadric(quadrics[to], quadrics[from]);
+    groupAlive[from] = false;
+    version[to]++;
+
+    // the costs of every edge at the new position changed
+    seenStamp++;
+    for (unsigned int v : wedges[to]) {
+        for (unsigned int t : vertexTris[v]) {
+            if (!triAlive[t]) continue;
+            for (int c = 0; c < 3; c++) {
+                unsigned int g = group[tris[3 * t + c]];
+                if (g == to || seen[g] == seenStamp) continue;
+                seen[g] = seenStamp;
+                push(g, to);
+                push(to, g);
+            }
+        }
+    }
+    return true;
+}
+
+std::vector<unsigned int> Simplifier::run(size_t targetIndexCount) {
+    while (liveIndices > targetIndexCount && !heap.empty()) {
+        collapseT c = heap.top();
+        heap.pop();
+        if (!groupAlive[c.from] || !groupAlive[c.to]) continue;
+        if (c.fromVersion != version[c.from] || c.toVersion != version[c.to]) continue;
+        tryCollapse(c.from, c.to);
+    }
+
+    std::vector<unsigned int> result;
+    result.reserve(liveIndices);
+    for (size_t t = 0; t < triAlive.size(); t++) {
+        if (!triAlive[t]) continue;
+        result.insert(result.end(), tris.begin() + 3 * t, tris.begin() + 3 * t + 3);
+    }
+    return result;
+}
+
+} // namespace
+
+std::vector<unsigned int> simplifyMesh(const std::vector<glm::vec3>& positions,
+                                       const std::vector<unsigned int>& indices,
+                                       size_t targetIndexCount) {
+    Simplifier simplifier(positions, indices);
+    return simplifier.run(targetIndexCount);
+}
+
+float projectedRadius(const glm::vec4& sphere, const glm::mat4& V, float projScale) {
+    glm::vec4 centre = V * glm::vec4(sphere.x, sphere.y, sphere.z, 1.0f);
+    float depth = -centre.z;
+    // camera inside or right at the sphere: as large as it gets
+    if (depth <= sphere.w) return 1e9f;
+    return sphere.w * projScale / depth;
+}
+
+int selectLod(float screenRadius, int currentLod, int levels) {
+    if (levels <= 1) return 0;
+    if (currentLod >= levels) currentLod = levels - 1;
+    if (currentLod < 0) currentLod = 0;
+
+    // level the radius asks for
+    int lod = 0;
+    while (lod + 1 < levels && screenRadius < LOD_SCREEN_RADIUS[lod]) lod++;
+
+    // only cross a threshold once the radius is clearly past it
+    while (lod > currentLod && screenRadius >= LOD_SCREEN_RADIUS[lod - 1] * (1.0f - LOD_HYSTERESIS)) lod--;
+    while (lod < currentLod && screenRadius < LOD_SCREEN_RADIUS[lod] * (1.0f + LOD_HYSTERESIS)) lod++;
+    return lod;
+}
@@ -0,0 +1,56 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Mesh levels of detail. The simplifier collapses edges in order of quadric error
+(Garland and Heckbert) onto one of their two vertices, so every level indexes the original
+vertices and only needs its own index list. Vertices at UV or normal seams only move along
+the seam and open borders are held in place. At draw time the level is chosen from the
+projected size of each instance, with hysteresis so it does not flicker at a threshold.
+*/
+
+#ifndef MESH_LOD_H
+#define MESH_LOD_H
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "chessCommon.h"
+
+// Projected radius (pixels) under which the next coarser level is used
+const float LOD_SCREEN_RADIUS[MAX_LOD_LEVELS - 1] = { 160.0f, 80.0f, 40.0f };
+// How far past a threshold the radius has to go before the level changes
+const float LOD_HYSTERESIS = 0.15f;
+// Levels are only built while they keep at least this many triangles
+const size_t MIN_LOD_TRIANGLES = 64;
+
+/**
+ * simplify a triangle list
+ * @param positions vertex positions, shared with the result
+ * @param indices triangles to simplify
+ * @param targetIndexCount stop once the triangle list is this short
+ * @return simplified triangle list over the same vertices, longer than the
+ * target if no more edges could be collapsed
+ */
+std::vector<unsigned int> simplifyMesh(const std::vector<glm::vec3>& positions,
+                                       const std::vector<unsigned int>& indices,
+                                       size_t targetIndexCount);
+
+/**
+ * radius of a bounding sphere on screen
+ * @param sphere world centre and radius
+ * @param V view matrix
+ * @param projScale projection y scale times half the viewport height
+ * @return radius in pixels
+ */
+float projectedRadius(const glm::vec4& sphere, const glm::mat4& V, float projScale);
+
+/**
+ * level of detail for an instance
+ * @param screenRadius projected radius in pixels
+ * @param currentLod level the instance used last frame
+ * @param levels levels the mesh has
+ * @return level to draw
+ */
+int selectLod(float screenRadius, int currentLod, int levels);
+
+#endif
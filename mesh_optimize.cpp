@@ -0,0 +1,214 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Implementation of the post-load mesh optimisation
+*/
+
+#include "mesh_optimize.h"
+#include <algorithm>
+#include <cmath>
+
+// Overdraw order may cost this much ACMR over the cache-only order
+const float OVERDRAW_ACMR_SLACK = 1.05f;
+
+vertexCacheStatsT analyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount) {
+    // the time each vertex entered the cache; it is still in while fewer than
+    // VERTEX_CACHE_SIZE other vertices came in after it
+    std::vector<unsigned int> entered(vertexCount, 0);
+    std::vector<bool> used(vertexCount, false);
+    unsigned int time = VERTEX_CACHE_SIZE + 1;
+    size_t misses = 0;
+    size_t unique = 0;
+    for (unsigned int v : indices) {
+        if (v >= vertexCount) continue;
+        if (time - entered[v] > VERTEX_CACHE_SIZE) {
+            entered[v] = time++;
+            misses++;
+        }
+        if (!used[v]) {
+            used[v] = true;
+            unique++;
+        }
+    }
+
+    vertexCacheStatsT stats;
+    size_t triangles = indices.size() / 3;
+    stats.acmr = triangles ? static_cast<float>(misses) / triangles : 0.0f;
+    stats.atvr = unique ? static_cast<float>(misses) / unique : 0.0f;
+    return stats;
+}
+
+// Tipsify: fan around one vertex at a time, moving on to the neighbour that is still in
+// the cache and has the fewest triangles left. Returns where each jump to an unrelated part
+// of the mesh happened: the cache starts over there, so the output can be split at them.
+static std::vector<unsigned int> tipsify(std::vector<unsigned int>& indices, size_t vertexCount) {
+    size_t triangles = indices.size() / 3;
+
+    // triangles around each vertex
+    std::vector<unsigned int> live(vertexCount, 0);
+    for (size_t i = 0; i < triangles * 3; i++) live[indices[i]]++;
+    std::vector<unsigned int> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) offsets[v + 1] = offsets[v] + live[v];
+    std::vector<unsigned int> adjacency(offsets[vertexCount]);
+    std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < triangles; t++) {
+        for (int c = 0; c < 3; c++) adjacency[fill[indices[3 * t + c]]++] = static_cast<unsigned int>(t);
+    }
+
+    std::vector<unsigned int> entered(vertexCount, 0);
+    std::vector<bool> emitted(triangles, false);
+    std::vector<unsigned int> deadEnd;
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> output;
+    output.reserve(triangles * 3);
+    std::vector<unsigned int> jumps(1, 0);
+    unsigned int time = VERTEX_CACHE_SIZE + 1;
+    size_t cursor = 0;
+
+    // start at the first vertex with any triangles
+    long fan = -1;
+    while (cursor < vertexCount && live[cursor] == 0) cursor++;
+    if (cursor < vertexCount) fan = static_cast<long>(cursor);
+
+    while (fan >= 0) {
+        candidates.clear();
+        for (unsigned int a = offsets[fan]; a < offsets[fan + 1]; a++) {
+            unsigned int t = adjacency[a];
+            if (emitted[t]) continue;
+            emitted[t] = true;
+            for (int c = 0; c < 3; c++) {
+                unsigned int v = indices[3 * t + c];
+                output.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - entered[v] > VERTEX_CACHE_SIZE) entered[v] = time++;
+            }
+        }
+
+        // best neighbour: one that will still be cached after its remaining triangles
+        fan = -1;
+        long best = -1;
+        for (unsigned int v : candidates) {
+            if (live[v] == 0) continue;
+            long priority = 0;
+            if (time - entered[v] + 2 * live[v] <= VERTEX_CACHE_SIZE) priority = time - entered[v];
+            if (priority > best) {
+                best = priority;
+                fan = v;
+            }
+        }
+        if (fan >= 0) continue;
+
+        // dead end: back to a recently used vertex, or the next one in order
+        while (!deadEnd.empty() && fan < 0) {
+            unsigned int v = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[v] > 0) fan = v;
+        }
+        while (fan < 0 && cursor < vertexCount) {
+            if (live[cursor] > 0) fan = static_cast<long>(cursor);
+            cursor++;
+        }
+        if (fan >= 0 && output.size() > 3 * jumps.back()) {
+            jumps.push_back(static_cast<unsigned int>(output.size() / 3));
+        }
+    }
+
+    indices.swap(output);
+    return jumps;
+}
+
+void optimizeTriangleOrder(std::vector<unsigned int>& indices, const std::vector<glm::vec3>& positions) {
+    indices.resize(indices.size() / 3 * 3);
+    size_t triangles = indices.size() / 3;
+    if (triangles == 0) return;
+    std::vector<unsigned int> boundaries = tipsify(indices, positions.size());
+    boundaries.push_back(static_cast<unsigned int>(triangles));
+
+    // clusters from the jumps: a cluster grows until it reaches the mesh's ACMR on a cold
+    // cache, so drawing them in any order costs little cache efficiency
+    float acmrLimit = OVERDRAW_ACMR_SLACK * analyzeVertexCache(indices, positions.size()).acmr;
+    std::vector<unsigned int> entered(positions.size(), 0);
+    unsigned int time = VERTEX_CACHE_SIZE + 1;
+    size_t misses = 0;
+    std::vector<unsigned int> clusterStarts(1, 0);
+    for (size_t b = 1; b < boundaries.size(); b++) {
+        for (unsigned int i = 3 * boundaries[b - 1]; i < 3 * boundaries[b]; i++) {
+            unsigned int v = indices[i];
+            if (time - entered[v] > VERTEX_CACHE_SIZE) {
+                entered[v] = time++;
+                misses++;
+            }
+        }
+        unsigned int clusterTriangles = boundaries[b] - clusterStarts.back();
+        if (static_cast<float>(misses) <= acmrLimit * clusterTriangles) {
+            clusterStarts.push_back(boundaries[b]);
+            // a new cluster starts with an empty cache
+            time += VERTEX_CACHE_SIZE + 1;
+            misses = 0;
+        }
+    }
+    if (clusterStarts.back() != triangles) clusterStarts.push_back(static_cast<unsigned int>(triangles));
+    size_t clusters = clusterStarts.size() - 1;
+    if (clusters < 2) return;
+
+    // how much each cluster faces away from the centre: those that face outwards occlude
+    // the rest, so they go first
+    glm::vec3 meshCentre(0.0f);
+    float meshArea = 0.0f;
+    std::vector<glm::vec3> clusterCentre(clusters, glm::vec3(0.0f));
+    std::vector<glm::vec3> clusterNormal(clusters, glm::vec3(0.0f));
+    std::vector<float> clusterArea(clusters, 0.0f);
+    for (size_t c = 0; c < clusters; c++) {
+        for (unsigned int t = clusterStarts[c]; t < clusterStarts[c + 1]; t++) {
+            const glm::vec3& p0 = positions[indices[3 * t]];
+            const glm::vec3& p1 = positions[indices[3 * t + 1]];
+            const glm::vec3& p2 = positions[indices[3 * t + 2]];
+            glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+            float area = 0.5f * std::sqrt(glm::dot(n, n));
+            glm::vec3 centroid = (p0 + p1 + p2) * (1.0f / 3.0f);
+            clusterCentre[c] += centroid * area;
+            clusterNormal[c] += n;
+            clusterArea[c] += area;
+        }
+        meshCentre += clusterCentre[c];
+        meshArea += clusterArea[c];
+    }
+    if (meshArea > 0.0f) meshCentre = meshCentre * (1.0f / meshArea);
+
+    std::vector<float> occlusion(clusters, 0.0f);
+    std::vector<unsigned int> order(clusters);
+    for (size_t c = 0; c < clusters; c++) {
+        order[c] = static_cast<unsigned int>(c);
+        float length = std::sqrt(glm::dot(clusterNormal[c], clusterNormal[c]));
+        if (clusterArea[c] <= 0.0f || length <= 0.0f) continue;
+        glm::vec3 centre = clusterCentre[c] * (1.0f / clusterArea[c]);
+        occlusion[c] = glm::dot(centre - meshCentre, clusterNormal[c]) / length;
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&](unsigned int a, unsigned int b) { return occlusion[a] > occlusion[b]; });
+
+    std::vector<unsigned int> sorted;
+    sorted.reserve(indices.size());
+    for (unsigned int c : order) {
+        sorted.insert(sorted.end(), indices.begin() + 3 * clusterStarts[c], indices.begin() + 3 * clusterStarts[c + 1]);
+    }
+    indices.swap(sorted);
+}
+
+std::vector<unsigned int> optimizeVertexFetch(std::vector<unsigned int>& indices, size_t vertexCount) {
+    const unsigned int UNUSED = ~0u;
+    std::vector<unsigned int> newIndex(vertexCount, UNUSED);
+    std::vector<unsigned int> oldIndex;
+    oldIndex.reserve(vertexCount);
+    for (unsigned int& v : indices) {
+        if (newIndex[v] == UNUSED) {
+            newIndex[v] = static_cast<unsigned int>(oldIndex.size());
+            oldIndex.push_back(v);
+        }
+        v = newIndex[v];
+    }
+    return oldIndex;
+}
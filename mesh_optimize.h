@@ -0,0 +1,50 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Post-load mesh optimisation. Triangles are reordered for the post-transform
+vertex cache with Tipsify (Sander, Nehab and Barczak), the clusters it produces are then
+sorted so outward-facing ones are drawn first to cut overdraw, and finally the vertices are
+renumbered in the order the triangles first use them so vertex fetch walks memory forwards.
+*/
+
+#ifndef MESH_OPTIMIZE_H
+#define MESH_OPTIMIZE_H
+
+#include <vector>
+#include <glm/glm.hpp>
+
+// Post-transform cache entries assumed by the optimiser and the statistics
+const unsigned int VERTEX_CACHE_SIZE = 16;
+
+// FIFO cache simulation of an index list
+typedef struct
+{
+    float acmr;     // vertices transformed per triangle, 0.5 at best, 3 at worst
+    float atvr;     // vertices transformed per vertex used, 1 at best
+} vertexCacheStatsT;
+
+/**
+ * simulate a FIFO post-transform cache
+ * @param indices triangle list
+ * @param vertexCount vertices the indices may refer to
+ * @return cache statistics
+ */
+vertexCacheStatsT analyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount);
+
+/**
+ * reorder triangles for the vertex cache, then order the resulting clusters against overdraw
+ * @param indices triangle list, reordered in place
+ * @param positions vertex positions, for the overdraw order
+ */
+void optimizeTriangleOrder(std::vector<unsigned int>& indices, const std::vector<glm::vec3>& positions);
+
+/**
+ * renumber vertices in the order the triangles first use them
+ * @param indices triangle list, rewritten to the new numbering
+ * @param vertexCount vertices before renumbering
+ * @return old vertex index of every new vertex; unused vertices are left out
+ */
+std::vector<unsigned int> optimizeVertexFetch(std::vector<unsigned int>& indices, size_t vertexCount);
+
+#endif
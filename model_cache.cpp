@@ -0,0 +1,126 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Implementation of the piece model matrix cache
+*/
+
+#include "model_cache.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define MODEL_CACHE_SSE 1
+#endif
+
+void multiplyMatrixBatch(const glm::mat4& a, const glm::mat4* b, glm::mat4* out, int n) {
+#ifdef MODEL_CACHE_SSE
+    // columns of a stay in registers for the whole batch
+    __m128 a0 = _mm_loadu_ps(&a[0][0]);
+    __m128 a1 = _mm_loadu_ps(&a[1][0]);
+    __m128 a2 = _mm_loadu_ps(&a[2][0]);
+    __m128 a3 = _mm_loadu_ps(&a[3][0]);
+    for (int i = 0; i < n; i++) {
+        for (int c = 0; c < 4; c++) {
+            // column c of the product is a times column c of b[i]
+            const float* col = &b[i][c][0];
+            __m128 r = _mm_mul_ps(a0, _mm_set1_ps(col[0]));
+            r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(col[1])));
+            r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(col[2])));
+            r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(col[3])));
+            _mm_storeu_ps(&out[i][c][0], r);
+        }
+    }
+#else
+    for (int i = 0; i < n; i++) {
+        out[i] = a * b[i];
+    }
+#endif
+}
+
+ModelMatrixCache::ModelMatrixCache() : viewProjection(1.0f), hasViewProjection(false) {
+    for (int m = 0; m < NUM_PIECE_MESHES; m++) {
+        meshModel[m] = glm::mat4(1.0f);
+        meshBounds[m] = glm::vec4(0.0f);
+    }
+    for (int i = 0; i < MAX_PIECES; i++) {
+        model[i] = glm::mat4(1.0f);
+        mvp[i] = glm::mat4(1.0f);
+        bounds[i] = glm::vec4(0.0f);
+        restPos[i] = glm::vec3(0);
+        cachedMesh[i] = 0;
+        atRest[i] = false;
+        valid[i] = false;
+    }
+}
+
+void ModelMatrixCache::setMeshModel(int mesh, const glm::mat4& modelMatrix) {
+    meshModel[mesh] = modelMatrix;
+    for (int i = 0; i < MAX_PIECES; i++) {
+        if (cachedMesh[i] == mesh) valid[i] = false;
+    }
+}
+
+void ModelMatrixCache::setMeshBounds(int mesh, const glm::vec3& centre, float radius) {
+    meshBounds[mesh] = glm::vec4(centre, radius);
+    for (int i = 0; i < MAX_PIECES; i++) {
+        if (cachedMesh[i] == mesh) valid[i] = false;
+    }
+}
+
+int ModelMatrixCache::update(const PieceTable& pieces, float animTime, const glm::mat4& VP) {
+    // a new camera invalidates every product, otherwise only the rebuilt models need one
+    bool newCamera = !hasViewProjection || VP != viewProjection;
+    viewProjection = VP;
+    hasViewProjection = true;
+
+    glm::mat4 batchIn[MAX_PIECES];
+    glm::mat4 batchOut[MAX_PIECES];
+    uint8_t batchPiece[MAX_PIECES];
+    int batchCount = 0;
+
+    for (int h = 0; h < pieces.count; h++) {
+        // same test as the vertex shader: the motion is over once its duration has passed
+        bool rest = animTime >= pieces.motionFrom[h].w + pieces.motionTo[h].w;
+        glm::vec3 target = glm::vec3(pieces.motionTo[h].x, pieces.motionTo[h].y, pieces.motionTo[h].z);
+        bool changed = !valid[h] || rest != atRest[h] || pieces.meshId[h] != cachedMesh[h] ||
+                       (rest && target != restPos[h]);
+        if (changed) {
+            cachedMesh[h] = pieces.meshId[h];
+            atRest[h] = rest;
+            restPos[h] = target;
+            valid[h] = true;
+            // a moving piece gets its position from the motion in the vertex shader
+            model[h] = rest ? glm::translate(glm::mat4(1.0f), target) * meshModel[cachedMesh[h]]
+                            : meshModel[cachedMesh[h]];
+            if (rest) bounds[h] = transformSphere(meshBounds[cachedMesh[h]], model[h]);
+        }
+        if (!rest) {
+            // the motion can be retargeted mid-flight, so the swept sphere is redone every frame:
+            // it encloses the straight path from start to end plus the hop arc above it
+            glm::vec4 local = transformSphere(meshBounds[cachedMesh[h]], model[h]);
+            glm::vec3 from = glm::vec3(pieces.motionFrom[h].x, pieces.motionFrom[h].y, pieces.motionFrom[h].z);
+            float hop = pieces.motionParams[h].y;
+            glm::vec3 path = target - from;
+            glm::vec3 centre = glm::vec3(local.x, local.y, local.z) + (from + target) * 0.5f;
+            centre.z += hop * 0.5f;
+            float radius = local.w + 0.5f * std::sqrt(glm::dot(path, path)) + 0.5f * std::fabs(hop);
+            bounds[h] = glm::vec4(centre, radius);
+        }
+        if (changed && !newCamera) {
+            batchIn[batchCount] = model[h];
+            batchPiece[batchCount++] = static_cast<uint8_t>(h);
+        }
+    }
+
+    if (newCamera) {
+        multiplyMatrixBatch(VP, model, mvp, pieces.count);
+        return pieces.count;
+    }
+    multiplyMatrixBatch(VP, batchIn, batchOut, batchCount);
+    for (int i = 0; i < batchCount; i++) {
+        mvp[batchPiece[i]] = batchOut[i];
+    }
+    return batchCount;
+}
@@ -0,0 +1,78 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Model and MVP matrices of the pieces, kept between frames. A piece at rest has
+its square baked into its model matrix, which is only rebuilt when it starts or stops
+moving or changes mesh. The MVP products are redone in one SIMD batch, for every piece when
+the camera moves and otherwise only for the pieces whose model matrix changed. Each piece
+also keeps a world-space bounding sphere for frustum culling, following its model matrix at
+rest and covering the whole path of its motion while it moves.
+*/
+
+#ifndef MODEL_CACHE_H
+#define MODEL_CACHE_H
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "piece_table.h"
+#include "frustum.h"
+
+/**
+ * out[i] = a * b[i] for n matrices
+ * @param a left-hand matrix shared by the whole batch
+ * @param b right-hand matrices
+ * @param out products, may not alias b
+ * @param n number of matrices
+ */
+void multiplyMatrixBatch(const glm::mat4& a, const glm::mat4* b, glm::mat4* out, int n);
+
+class ModelMatrixCache {
+private:
+    glm::mat4 meshModel[NUM_PIECE_MESHES];  // places each mesh at the origin, baked at load
+    glm::vec4 meshBounds[NUM_PIECE_MESHES]; // xyz centre and w radius, in mesh coordinates
+
+    // one entry per piece handle
+    glm::mat4 model[MAX_PIECES];            // mesh model, plus the square when at rest
+    glm::mat4 mvp[MAX_PIECES];
+    glm::vec4 bounds[MAX_PIECES];           // world bounding sphere, xyz centre, w radius
+    glm::vec3 restPos[MAX_PIECES];          // square baked into model
+    uint8_t cachedMesh[MAX_PIECES];
+    bool atRest[MAX_PIECES];
+    bool valid[MAX_PIECES];
+
+    glm::mat4 viewProjection;
+    bool hasViewProjection;
+
+public:
+    ModelMatrixCache();
+
+    // set the model matrix of a mesh; every piece using it is rebuilt
+    void setMeshModel(int mesh, const glm::mat4& modelMatrix);
+
+    /**
+     * set the bounding sphere of a mesh
+     * @param mesh PIECE_MESH_NAMES index
+     * @param centre centre in the mesh's own coordinates, before its model matrix
+     * @param radius radius in the same coordinates
+     */
+    void setMeshBounds(int mesh, const glm::vec3& centre, float radius);
+
+    /**
+     * bring the matrices up to date for this frame
+     * @param pieces entity table, read for mesh and motion
+     * @param animTime time the vertex shader evaluates the motion at
+     * @param VP view-projection matrix of the frame
+     * @return number of MVP products computed
+     */
+    int update(const PieceTable& pieces, float animTime, const glm::mat4& VP);
+
+    // at rest the square is in the model matrix and the motion offset must be zero
+    bool isAtRest(pieceHandleT piece) const { return atRest[piece]; }
+    const glm::mat4& getModel(pieceHandleT piece) const { return model[piece]; }
+    const glm::mat4& getMVP(pieceHandleT piece) const { return mvp[piece]; }
+    // indexed by piece handle, pieces.count entries
+    const glm::vec4* getBounds() const { return bounds; }
+};
+
+#endif
@@ -0,0 +1,104 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Implementation of the piece entity table
+*/
+
+#include "piece_table.h"
+#include "chessCommon.h"
+
+// Component names in Lab3/Chess/chess-mod.obj, white pieces first
+const char* const PIECE_MESH_NAMES[NUM_PIECE_MESHES] = {
+    "PEDONE13", "Object3", "ALFIERE3", "TORRE3", "REGINA2", "RE2",
+    "PEDONE12", "Object02", "ALFIERE02", "TORRE02", "REGINA01", "RE01"
+};
+
+void PieceTable::clear() {
+    count = 0;
+    for (int i = 0; i < MAX_PIECES; i++) {
+        meshId[i] = 0;
+        colour[i] = 0;
+        square[i] = NO_SQUARE;
+        worldPos[i] = glm::vec3(0);
+        alpha[i] = 0.0f;
+        alive[i] = false;
+        motionFrom[i] = glm::vec4(0);
+        motionTo[i] = glm::vec4(0);
+        motionParams[i] = glm::vec4(0);
+    }
+    for (int sq = 0; sq < 64; sq++) bySquare[sq] = NO_PIECE;
+}
+
+/**
+ * create the entities for a position
+ * @param board position to take the pieces from
+ */
+void PieceTable::reset(const ChessBoard& board) {
+    clear();
+    for (int sq = 0; sq < 64 && count < MAX_PIECES; sq++) {
+        int piece = board.pieceAt(sq);
+        if (piece == PIECE_NONE) continue;
+        int h = count++;
+        meshId[h] = static_cast<uint8_t>(pieceMeshId(piece));
+        colour[h] = pieceIsBlack(piece) ? 1 : 0;
+        square[h] = static_cast<uint8_t>(sq);
+        const squarePosT& p = SQUARE_POSITIONS.pos[sq];
+        worldPos[h] = glm::vec3(p.x, p.y, p.z);
+        alpha[h] = 1.0f;
+        alive[h] = true;
+        // at rest: start and end on the square, fully opaque
+        motionFrom[h] = glm::vec4(worldPos[h], 0.0f);
+        motionTo[h] = glm::vec4(worldPos[h], 0.0f);
+        motionParams[h] = glm::vec4(0.0f, 0.0f, 1.0f, 0.0f);
+        bySquare[sq] = static_cast<pieceHandleT>(h);
+    }
+}
+
+void PieceTable::moveTo(pieceHandleT piece, int sq) {
+    if (square[piece] != NO_SQUARE && bySquare[square[piece]] == piece) {
+        bySquare[square[piece]] = NO_PIECE;
+    }
+    square[piece] = static_cast<uint8_t>(sq);
+    bySquare[sq] = piece;
+}
+
+void PieceTable::capture(pieceHandleT piece) {
+    if (square[piece] != NO_SQUARE && bySquare[square[piece]] == piece) {
+        bySquare[square[piece]] = NO_PIECE;
+    }
+    square[piece] = NO_SQUARE;
+    alive[piece] = false;
+}
+
+void PieceTable::restore(pieceHandleT piece, int sq) {
+    alive[piece] = true;
+    square[piece] = static_cast<uint8_t>(sq);
+    bySquare[sq] = piece;
+    const squarePosT& p = SQUARE_POSITIONS.pos[sq];
+    worldPos[piece] = glm::vec3(p.x, p.y, p.z);
+}
+
+void PieceTable::setMotion(pieceHandleT piece, const glm::vec3& from, const glm::vec3& to,
+                           float startTime, float duration, int curve, float hop) {
+    motionFrom[piece] = glm::vec4(from, startTime);
+    motionTo[piece] = glm::vec4(to, duration);
+    motionParams[piece].x = static_cast<float>(curve);
+    motionParams[piece].y = hop;
+}
+
+void PieceTable::setFade(pieceHandleT piece, float fromAlpha, float toAlpha, float startTime, float duration) {
+    // shift the start back so the fade picks up at the current alpha
+    if (toAlpha > fromAlpha) {
+        motionParams[piece].z = startTime - fromAlpha * duration;
+        motionParams[piece].w = duration;
+    } else {
+        motionParams[piece].z = startTime - (1.0f - fromAlpha) * duration;
+        motionParams[piece].w = -duration;
+    }
+}
+
+void PieceTable::settleFade(pieceHandleT piece) {
+    motionParams[piece].z = alpha[piece];
+    motionParams[piece].w = 0.0f;
+}
@@ -0,0 +1,73 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Entity table of the 32 chess pieces, stored as parallel arrays and addressed by
+small integer handles. The game updates it as moves are made and the renderer reads it
+directly every frame.
+*/
+
+#ifndef PIECE_TABLE_H
+#define PIECE_TABLE_H
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "chess_board.h"
+
+typedef uint8_t pieceHandleT;
+
+const int MAX_PIECES = 32;
+const pieceHandleT NO_PIECE = 0xFF;
+
+// Render meshes, one per piece type and colour: colour * 6 + (type - 1)
+const int NUM_PIECE_MESHES = 12;
+extern const char* const PIECE_MESH_NAMES[NUM_PIECE_MESHES];
+
+inline int pieceMeshId(int piece) {
+    return (pieceIsBlack(piece) ? 6 : 0) + pieceType(piece) - 1;
+}
+inline int meshPieceType(int meshId) { return meshId % 6 + 1; }
+
+class PieceTable {
+public:
+    // one entry per piece, indexed by handle
+    uint8_t meshId[MAX_PIECES];        // PIECE_MESH_NAMES index
+    uint8_t colour[MAX_PIECES];        // 0 white, 1 black
+    uint8_t square[MAX_PIECES];        // board square, NO_SQUARE once captured
+    glm::vec3 worldPos[MAX_PIECES];    // current render position
+    float alpha[MAX_PIECES];           // render opacity, captured pieces fade to 0
+    bool alive[MAX_PIECES];            // still on the board
+    int count;
+
+    // motion of each piece as the vertex shader evaluates it, see StandardShading.vertexshader
+    glm::vec4 motionFrom[MAX_PIECES];    // xyz start position, w start time
+    glm::vec4 motionTo[MAX_PIECES];      // xyz end position, w duration
+    glm::vec4 motionParams[MAX_PIECES];  // x easing curve, y hop height, z/w fade (see setFade)
+
+    // reverse lookup, NO_PIECE for an empty square
+    pieceHandleT bySquare[64];
+
+    PieceTable() { clear(); }
+
+    void clear();
+    // one entity for each piece on the board, standing on its square
+    void reset(const ChessBoard& board);
+
+    pieceHandleT atSquare(int sq) const { return bySquare[sq]; }
+    // move a piece to a new square; its world position is left to the animation
+    void moveTo(pieceHandleT piece, int sq);
+    void capture(pieceHandleT piece);
+    void restore(pieceHandleT piece, int sq);
+
+    // record a move for the vertex shader
+    void setMotion(pieceHandleT piece, const glm::vec3& from, const glm::vec3& to,
+                   float startTime, float duration, int curve, float hop);
+    // record a fade for the vertex shader: z is the time the fade would have started
+    // from fully in/out, w the duration, negative when fading out
+    void setFade(pieceHandleT piece, float fromAlpha, float toAlpha, float startTime, float duration);
+    // fade finished, hold alpha constant (z = alpha, w = 0)
+    void settleFade(pieceHandleT piece);
+    bool isFading(pieceHandleT piece) const { return motionParams[piece].w != 0.0f; }
+};
+
+#endif
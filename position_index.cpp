@@ -0,0 +1,262 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Implementation of the position index builder and mmap-backed prober
+*/
+
+#include "position_index.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const uint32_t INDEX_VERSION = 1;
+
+// one position of one game while building
+struct buildEntryT {
+    uint64_t hash;
+    uint32_t gameId;
+    uint16_t ply;
+    moveT nextMove;
+
+    bool operator<(const buildEntryT& o) const {
+        if (hash != o.hash) return hash < o.hash;
+        if (gameId != o.gameId) return gameId < o.gameId;
+        return ply < o.ply;
+    }
+};
+
+/**
+ * replay a range of games and collect a sorted entry list
+ * @param games all game lines
+ * @param begin first game id of the range
+ * @param end one past the last game id
+ * @param out sorted entries for the range
+ */
+void replayGames(const std::vector<std::string>& games, size_t begin, size_t end,
+                 std::vector<buildEntryT>& out) {
+    for (size_t g = begin; g < end; g++) {
+        ChessBoard board;
+        std::istringstream moves(games[g]);
+        std::string uci;
+        uint16_t ply = 0;
+        while (moves >> uci) {
+            moveT m = ChessBoard::parseUciMove(uci);
+            buildEntryT e = {board.getHash(), static_cast<uint32_t>(g), ply, m};
+            // stop at the first move we cannot replay
+            if (m == NULL_MOVE || !board.applyMove(m)) break;
+            out.push_back(e);
+            ply++;
+        }
+        buildEntryT last = {board.getHash(), static_cast<uint32_t>(g), ply, NULL_MOVE};
+        out.push_back(last);
+    }
+    std::sort(out.begin(), out.end());
+}
+
+}
+
+PositionIndex::PositionIndex()
+    : fd(-1), mapped(nullptr), mappedSize(0), header(nullptr), keys(nullptr), postings(nullptr) {}
+
+PositionIndex::~PositionIndex() {
+    close();
+}
+
+/**
+ * build the index file
+ * @param gamesPath text file with one game per line
+ * @param indexPath output index file
+ * @param numThreads worker count, 0 for one per hardware thread
+ * @return true if the index was written
+ */
+bool PositionIndex::build(const std::string& gamesPath, const std::string& indexPath,
+                          unsigned int numThreads) {
+    std::ifstream in(gamesPath);
+    if (!in) {
+        std::cout << "Cannot open games file: " << gamesPath << std::endl;
+        return false;
+    }
+    std::vector<std::string> games;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        games.push_back(line);
+    }
+
+    if (numThreads == 0) numThreads = std::max(1u, std::thread::hardware_concurrency());
+    numThreads = static_cast<unsigned int>(std::min<size_t>(numThreads, std::max<size_t>(1, games.size())));
+
+    // replay and sort each slice of the database in parallel
+    std::vector<std::vector<buildEntryT>> parts(numThreads);
+    std::vector<std::thread> workers;
+    for (unsigned int t = 0; t < numThreads; t++) {
+        size_t begin = games.size() * t / numThreads;
+        size_t end = games.size() * (t + 1) / numThreads;
+        workers.emplace_back(replayGames, std::cref(games), begin, end, std::ref(parts[t]));
+    }
+    for (auto& w : workers) w.join();
+    workers.clear();
+
+    // merge the sorted slices pairwise, each round in parallel
+    while (parts.size() > 1) {
+        std::vector<std::vector<buildEntryT>> merged((parts.size() + 1) / 2);
+        for (size_t i = 0; i + 1 < parts.size(); i += 2) {
+            workers.emplace_back([&parts, &merged, i]() {
+                merged[i / 2].resize(parts[i].size() + parts[i + 1].size());
+                std::merge(parts[i].begin(), parts[i].end(), parts[i + 1].begin(), parts[i + 1].end(),
+                           merged[i / 2].begin());
+                std::vector<buildEntryT>().swap(parts[i]);
+                std::vector<buildEntryT>().swap(parts[i + 1]);
+            });
+        }
+        if (parts.size() % 2) merged.back().swap(parts.back());
+        for (auto& w : workers) w.join();
+        workers.clear();
+        parts.swap(merged);
+    }
+    const std::vector<buildEntryT>& entries = parts.front();
+
+    // key table
+    std::vector<indexKeyT> keyTable;
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (keyTable.empty() || keyTable.back().hash != entries[i].hash) {
+            indexKeyT k = {entries[i].hash, i, 0, 0};
+            keyTable.push_back(k);
+        }
+        keyTable.back().count++;
+    }
+
+    FILE* out = fopen(indexPath.c_str(), "wb");
+    if (!out) {
+        std::cout << "Cannot write index file: " << indexPath << std::endl;
+        return false;
+    }
+    indexHeaderT hdr;
+    memcpy(hdr.magic, "CPIX", 4);
+    hdr.version = INDEX_VERSION;
+    hdr.numGames = static_cast<uint32_t>(games.size());
+    hdr.numKeys = static_cast<uint32_t>(keyTable.size());
+    hdr.numPostings = entries.size();
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, out) == 1;
+    if (!keyTable.empty()) {
+        ok = ok && fwrite(keyTable.data(), sizeof(indexKeyT), keyTable.size(), out) == keyTable.size();
+    }
+    std::vector<indexPostingT> postingBuf;
+    postingBuf.reserve(std::min<size_t>(entries.size(), 1 << 16));
+    for (size_t i = 0; ok && i < entries.size(); i++) {
+        indexPostingT p = {entries[i].gameId, entries[i].ply, entries[i].nextMove};
+        postingBuf.push_back(p);
+        if (postingBuf.size() == postingBuf.capacity() || i + 1 == entries.size()) {
+            ok = fwrite(postingBuf.data(), sizeof(indexPostingT), postingBuf.size(), out) == postingBuf.size();
+            postingBuf.clear();
+        }
+    }
+    ok = (fclose(out) == 0) && ok;
+    if (!ok) {
+        std::cout << "Failed writing index file: " << indexPath << std::endl;
+        return false;
+    }
+    std::cout << "Indexed " << games.size() << " games, " << keyTable.size() << " positions using "
+              << numThreads << " threads" << std::endl;
+    return true;
+}
+
+/**
+ * map an index file read-only
+ * @param indexPath index file
+ * @return true if the file is a valid index
+ */
+bool PositionIndex::open(const std::string& indexPath) {
+    close();
+    fd = ::open(indexPath.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(indexHeaderT))) {
+        close();
+        return false;
+    }
+    mappedSize = static_cast<size_t>(st.st_size);
+    mapped = mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        mapped = nullptr;
+        close();
+        return false;
+    }
+
+    header = static_cast<const indexHeaderT*>(mapped);
+    size_t expected = sizeof(indexHeaderT) + header->numKeys * sizeof(indexKeyT) +
+                      header->numPostings * sizeof(indexPostingT);
+    if (memcmp(header->magic, "CPIX", 4) != 0 || header->version != INDEX_VERSION ||
+        expected != mappedSize) {
+        std::cout << "Invalid or stale index file: " << indexPath << std::endl;
+        close();
+        return false;
+    }
+    keys = reinterpret_cast<const indexKeyT*>(header + 1);
+    postings = reinterpret_cast<const indexPostingT*>(keys + header->numKeys);
+    return true;
+}
+
+void PositionIndex::close() {
+    if (mapped) munmap(mapped, mappedSize);
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+    mapped = nullptr;
+    mappedSize = 0;
+    header = nullptr;
+    keys = nullptr;
+    postings = nullptr;
+}
+
+/**
+ * look up the games that reached a position
+ * @param hash Zobrist hash of the position
+ * @param out first posting for the position
+ * @return number of postings
+ */
+size_t PositionIndex::probe(uint64_t hash, const indexPostingT*& out) const {
+    out = nullptr;
+    if (!mapped) return 0;
+    const indexKeyT* end = keys + header->numKeys;
+    const indexKeyT* it = std::lower_bound(keys, end, hash,
+        [](const indexKeyT& k, uint64_t h) { return k.hash < h; });
+    if (it == end || it->hash != hash) return 0;
+    out = postings + it->first;
+    return it->count;
+}
+
+/**
+ * count the moves played from a position
+ * @param hash Zobrist hash of the position
+ * @param stats moves with their counts, most played first
+ */
+void PositionIndex::openingStats(uint64_t hash, std::vector<moveStatT>& stats) const {
+    stats.clear();
+    const indexPostingT* list;
+    size_t n = probe(hash, list);
+    for (size_t i = 0; i < n; i++) {
+        if (list[i].nextMove == NULL_MOVE) continue;
+        auto it = std::find_if(stats.begin(), stats.end(),
+            [&](const moveStatT& s) { return s.move == list[i].nextMove; });
+        if (it != stats.end()) {
+            it->count++;
+        } else {
+            moveStatT s = {list[i].nextMove, 1};
+            stats.push_back(s);
+        }
+    }
+    std::sort(stats.begin(), stats.end(),
+        [](const moveStatT& a, const moveStatT& b) { return a.count > b.count; });
+}
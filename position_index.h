@@ -0,0 +1,80 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Disk-resident position index over the game database. Maps the Zobrist hash of
+every position reached in the stored games to a posting list of (game id, ply, next move).
+The index is built in parallel at import time and probed through mmap, so lookups are a
+binary search over the mapped key table instead of a scan of the games.
+*/
+
+#ifndef POSITION_INDEX_H
+#define POSITION_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "chess_board.h"
+
+// on-disk records, all little endian and tightly packed
+struct indexHeaderT {
+    char magic[4];          // "CPIX"
+    uint32_t version;
+    uint32_t numGames;
+    uint32_t numKeys;
+    uint64_t numPostings;
+};
+
+struct indexKeyT {
+    uint64_t hash;
+    uint64_t first;         // offset into the postings table
+    uint32_t count;
+    uint32_t reserved;
+};
+
+struct indexPostingT {
+    uint32_t gameId;
+    uint16_t ply;
+    moveT nextMove;         // NULL_MOVE when the game ended in this position
+};
+
+// how often a move was played from a position
+struct moveStatT {
+    moveT move;
+    unsigned int count;
+};
+
+class PositionIndex {
+private:
+    int fd;
+    void* mapped;
+    size_t mappedSize;
+    const indexHeaderT* header;
+    const indexKeyT* keys;
+    const indexPostingT* postings;
+
+public:
+    PositionIndex();
+    ~PositionIndex();
+
+    // Build an index file from a games file (one game per line, uci moves separated by
+    // spaces, '#' starts a comment line). Games are replayed on worker threads.
+    static bool build(const std::string& gamesPath, const std::string& indexPath,
+                      unsigned int numThreads = 0);
+
+    // map an index file for probing
+    bool open(const std::string& indexPath);
+    void close();
+    bool isOpen() const { return mapped != nullptr; }
+
+    // posting list for a position, returns the number of postings
+    size_t probe(uint64_t hash, const indexPostingT*& out) const;
+
+    // next-move statistics for a position, most played first
+    void openingStats(uint64_t hash, std::vector<moveStatT>& stats) const;
+
+    unsigned int numGames() const { return header ? header->numGames : 0; }
+};
+
+#endif
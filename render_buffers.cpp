@@ -0,0 +1,133 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Implementation of the per-frame uniform buffer and the instance ring
+*/
+
+#include "render_buffers.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+bool FrameUniformBuffer::create(GLuint programID) {
+    GLuint blockIndex = glGetUniformBlockIndex(programID, "FrameBlock");
+    if (blockIndex == GL_INVALID_INDEX) {
+        std::cout << "Shader has no FrameBlock uniform block" << std::endl;
+        return false;
+    }
+    glUniformBlockBinding(programID, blockIndex, FRAME_BLOCK_BINDING);
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(frameBlockT), NULL, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_BLOCK_BINDING, buffer);
+    return true;
+}
+
+void FrameUniformBuffer::destroy() {
+    glDeleteBuffers(1, &buffer);
+    buffer = 0;
+}
+
+void FrameUniformBuffer::update(const frameBlockT& block) {
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(frameBlockT), &block);
+}
+
+InstanceRing::InstanceRing()
+    : buffer(0), perFrame(0), frames(0), frame(0), used(0), mapped(NULL) {
+    for (unsigned int i = 0; i < MAX_RING_FRAMES; i++) fences[i] = 0;
+}
+
+bool InstanceRing::create(unsigned int instancesPerFrame, unsigned int frameCount) {
+    perFrame = instancesPerFrame;
+    frames = (frameCount < 1) ? 1 : (frameCount > MAX_RING_FRAMES ? MAX_RING_FRAMES : frameCount);
+    frame = 0;
+    used = 0;
+    GLsizeiptr size = static_cast<GLsizeiptr>(perFrame) * frames * sizeof(instanceDataT);
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    if (GLEW_ARB_buffer_storage) {
+        // mapped once for the lifetime of the buffer, writes are seen by the GPU directly
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+        mapped = static_cast<instanceDataT*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags));
+    }
+    if (mapped == NULL) {
+        // no persistent mapping, each frame's region is uploaded in one call
+        if (GLEW_ARB_buffer_storage) {
+            // immutable storage cannot be respecified, start over with a plain buffer
+            glDeleteBuffers(1, &buffer);
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        }
+        glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+        staging.reserve(perFrame);
+    }
+    return buffer != 0;
+}
+
+void InstanceRing::destroy() {
+    for (unsigned int i = 0; i < MAX_RING_FRAMES; i++) {
+        if (fences[i]) glDeleteSync(fences[i]);
+        fences[i] = 0;
+    }
+    if (mapped) {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        mapped = NULL;
+    }
+    glDeleteBuffers(1, &buffer);
+    buffer = 0;
+}
+
+bool InstanceRing::reserve(unsigned int instancesPerFrame) {
+    if (instancesPerFrame <= perFrame) return false;
+    // doubling keeps a slowly growing scene from reallocating every frame; the GPU keeps
+    // the old buffer alive for the draws still reading it
+    unsigned int frameCount = frames;
+    unsigned int grown = std::max(instancesPerFrame, 2 * perFrame);
+    destroy();
+    return create(grown, frameCount);
+}
+
+void InstanceRing::beginFrame() {
+    used = 0;
+    staging.clear();
+    if (fences[frame]) {
+        // normally long signalled, the region was last used frames ago
+        while (glClientWaitSync(fences[frame], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {
+        }
+        glDeleteSync(fences[frame]);
+        fences[frame] = 0;
+    }
+}
+
+bool InstanceRing::push(const instanceDataT* instances, unsigned int count, unsigned int& baseInstance) {
+    if (used + count > perFrame) return false;
+    baseInstance = frame * perFrame + used;
+    if (mapped) {
+        std::memcpy(mapped + baseInstance, instances, count * sizeof(instanceDataT));
+    } else {
+        staging.insert(staging.end(), instances, instances + count);
+    }
+    used += count;
+    return true;
+}
+
+void InstanceRing::flush() {
+    if (mapped || staging.empty()) return;
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    // staged instances are the last ones pushed this frame
+    GLintptr first = frame * perFrame + used - static_cast<unsigned int>(staging.size());
+    glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(instanceDataT),
+                    staging.size() * sizeof(instanceDataT), staging.data());
+    staging.clear();
+}
+
+void InstanceRing::endFrame() {
+    fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    frame = (frame + 1) % frames;
+}
@@ -0,0 +1,104 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: GPU buffers for the render loop's per-frame and per-draw state. The per-frame
+values (camera, light, animation time) live in one uniform block updated once a frame, and
+the per-draw instance records are streamed through a ring buffer split into one region per
+frame in flight, so writing a frame never waits for the GPU to finish reading the last one.
+*/
+
+#ifndef RENDER_BUFFERS_H
+#define RENDER_BUFFERS_H
+
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "chessCommon.h"
+
+// FrameBlock of StandardShading.vertexshader/.fragmentshader, std140 layout
+typedef struct
+{
+    glm::mat4 VP;
+    glm::mat4 V;
+    glm::vec4 lightPosition;  // xyz used
+    float lightPower;
+    int lightSwitch;
+    float animTime;
+    float pad;
+} frameBlockT;
+
+// binding point of FrameBlock
+const GLuint FRAME_BLOCK_BINDING = 0;
+
+class FrameUniformBuffer {
+private:
+    GLuint buffer;
+
+public:
+    FrameUniformBuffer() : buffer(0) {}
+
+    /**
+     * create the buffer and attach it to the program's FrameBlock
+     * @param programID linked shader program
+     * @return false if the program has no FrameBlock
+     */
+    bool create(GLuint programID);
+    void destroy();
+    // upload the values of this frame
+    void update(const frameBlockT& block);
+};
+
+// frames the ring keeps in flight
+const unsigned int MAX_RING_FRAMES = 4;
+
+class InstanceRing {
+private:
+    GLuint buffer;
+    unsigned int perFrame;      // instances each frame may write
+    unsigned int frames;
+    unsigned int frame;         // region written this frame
+    unsigned int used;          // instances written this frame
+    instanceDataT* mapped;      // persistent mapping, NULL when not supported
+    std::vector<instanceDataT> staging;  // this frame's instances without a mapping
+    GLsync fences[MAX_RING_FRAMES];
+
+public:
+    InstanceRing();
+
+    /**
+     * allocate the ring, persistently mapped when the driver supports buffer storage
+     * @param instancesPerFrame capacity of one frame's region
+     * @param frameCount regions in the ring (at most MAX_RING_FRAMES)
+     * @return true on success
+     */
+    bool create(unsigned int instancesPerFrame, unsigned int frameCount = 3);
+    void destroy();
+    /**
+     * make room for a frame's instances before beginFrame, replacing the buffer with one at
+     * least twice as large if they do not fit; whatever reads the old buffer must be pointed
+     * at getBuffer() again
+     * @param instancesPerFrame instances the coming frames write
+     * @return true if the buffer was replaced
+     */
+    bool reserve(unsigned int instancesPerFrame);
+    unsigned int capacity() const { return perFrame; }
+
+    // wait until the GPU is done with this frame's region
+    void beginFrame();
+    /**
+     * write instances into this frame's region
+     * @param baseInstance index of the first one in the buffer
+     * @return false if the region is full
+     */
+    bool push(const instanceDataT* instances, unsigned int count, unsigned int& baseInstance);
+    // make this frame's instances visible to the GPU; call before drawing them
+    void flush();
+    // fence the region and move to the next one
+    void endFrame();
+
+    GLuint getBuffer() const { return buffer; }
+    bool isPersistent() const { return mapped != NULL; }
+};
+
+#endif
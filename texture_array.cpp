@@ -0,0 +1,400 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Implementation of the scene texture arrays
+*/
+
+#include "texture_array.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <common/texture.hpp>
+#include "texture_compress.h"
+
+// Upper limit of anisotropic filtering
+const float MAX_ANISOTROPY = 8.0f;
+// Pixel buffers in the upload ring, each holds one layer
+const unsigned int TEXTURE_PIXEL_BUFFERS = 3;
+// Bytes uploaded a frame at most; one layer always goes
+const size_t TEXTURE_UPLOAD_BUDGET = 4 * 1024 * 1024;
+// Decoding threads at most
+const unsigned int MAX_TEXTURE_WORKERS = 4;
+
+// The converted texture next to a BMP, as bmp_to_dds writes it
+static std::string ddsPathFor(const std::string& path) {
+    std::string::size_type dot = path.find_last_of('.');
+    return (dot == std::string::npos ? path : path.substr(0, dot)) + ".dds";
+}
+
+static GLenum compressedFormat(unsigned int fourCC) {
+    return fourCC == FOURCC_BC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+}
+
+TextureArraySet::TextureArraySet()
+    : firstUnit(0), nextDecode(0), stopping(false), nextBuffer(0), bufferSize(0), pending(0) {
+}
+
+TextureArraySet::~TextureArraySet() {
+    stopWorkers();
+}
+
+int TextureArraySet::addImage(const std::string& path) {
+    imageT image;
+    image.path = path;
+    image.fourCC = 0;
+    image.levels = 1;
+    image.location.array = -1;
+    image.location.layer = 0;
+    image.resident = false;
+
+    // prefer the compressed mip chain when it has been converted and the GL can sample it
+    unsigned int fourCC = 0, levels = 0;
+    if (GLEW_EXT_texture_compression_s3tc &&
+        readDDSSize(ddsPathFor(path).c_str(), image.width, image.height, fourCC, levels) &&
+        (fourCC == FOURCC_BC1 || fourCC == FOURCC_BC3) && image.width > 0 && image.height > 0) {
+        image.fourCC = fourCC;
+        image.levels = levels;
+    } else if (!readBMPSize(path.c_str(), image.width, image.height) || image.width == 0 || image.height == 0) {
+        std::cout << "Texture " << path << " could not be read" << std::endl;
+        return -1;
+    }
+    images.push_back(image);
+    return static_cast<int>(images.size()) - 1;
+}
+
+bool TextureArraySet::build() {
+    streamStart = std::chrono::steady_clock::now();
+
+    // compressed images are already at their array's layer size, they share an array with
+    // images of the same size and format only
+    std::vector<std::vector<int>> groups;
+    std::vector<int> plain;
+    std::vector<int> compressedFirst;
+    for (size_t i = 0; i < images.size(); i++) {
+        if (images[i].fourCC == 0) {
+            plain.push_back(static_cast<int>(i));
+            continue;
+        }
+        bool found = false;
+        for (int first : compressedFirst) {
+            found = found || (images[first].width == images[i].width && images[first].height == images[i].height &&
+                              images[first].fourCC == images[i].fourCC);
+        }
+        if (!found) compressedFirst.push_back(static_cast<int>(i));
+    }
+    // one sampler stays for the BMPs, including those left over when there are too many formats
+    bool plainArrays = !plain.empty() || static_cast<int>(compressedFirst.size()) > MAX_TEXTURE_ARRAYS;
+    size_t compressedArrays = std::min(compressedFirst.size(), static_cast<size_t>(MAX_TEXTURE_ARRAYS - (plainArrays ? 1 : 0)));
+    groups.resize(compressedArrays);
+    for (size_t i = 0; i < images.size(); i++) {
+        imageT& image = images[i];
+        if (image.fourCC == 0) continue;
+        bool placed = false;
+        for (size_t g = 0; g < compressedArrays && !placed; g++) {
+            const imageT& first = images[compressedFirst[g]];
+            if (first.width == image.width && first.height == image.height && first.fourCC == image.fourCC) {
+                groups[g].push_back(static_cast<int>(i));
+                placed = true;
+            }
+        }
+        if (!placed && readBMPSize(image.path.c_str(), image.width, image.height)) {
+            image.fourCC = 0;
+            image.levels = 1;
+            plain.push_back(static_cast<int>(i));
+        }
+    }
+
+    // BMPs: an image joins the first array it is close enough in size to, or starts one
+    std::vector<unsigned int> widths, heights;
+    for (int i : plain) {
+        widths.push_back(images[i].width);
+        heights.push_back(images[i].height);
+    }
+    std::vector<std::vector<int>> plainGroups = groupBySize(widths, heights, MAX_TEXTURE_ARRAYS - static_cast<int>(groups.size()));
+    for (const std::vector<int>& group : plainGroups) {
+        groups.push_back(std::vector<int>());
+        for (int member : group) groups.back().push_back(plain[member]);
+    }
+
+    bool anisotropic = GLEW_EXT_texture_filter_anisotropic;
+    float anisotropy = 1.0f;
+    if (anisotropic) {
+        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &anisotropy);
+        anisotropy = std::min(anisotropy, MAX_ANISOTROPY);
+    }
+
+    // allocate every array now, the layers are filled in as they are decoded
+    size_t bytes = 0;
+    unsigned int compressedImages = 0;
+    for (size_t g = 0; g < groups.size(); g++) {
+        arrayT array;
+        array.layers = static_cast<int>(groups[g].size());
+        array.uploaded = 0;
+        array.finished = 0;
+        array.fourCC = images[groups[g].front()].fourCC;
+        glGenTextures(1, &array.texture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, array.texture);
+        if (array.fourCC != 0) {
+            array.width = images[groups[g].front()].width;
+            array.height = images[groups[g].front()].height;
+            array.levels = images[groups[g].front()].levels;
+            for (int i : groups[g]) array.levels = std::min(array.levels, images[i].levels);
+            for (unsigned int l = 0; l < array.levels; l++) {
+                unsigned int levelWidth = std::max(1u, array.width >> l);
+                unsigned int levelHeight = std::max(1u, array.height >> l);
+                size_t size = compressedLevelSize(levelWidth, levelHeight, array.fourCC) * array.layers;
+                glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, l, compressedFormat(array.fourCC), levelWidth, levelHeight,
+                                       array.layers, 0, static_cast<GLsizei>(size), NULL);
+                bytes += size;
+            }
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(array.levels) - 1);
+            compressedImages += array.layers;
+        } else {
+            // layers take the average size of the group's images
+            std::vector<unsigned int> groupWidths, groupHeights;
+            for (int i : groups[g]) {
+                groupWidths.push_back(images[i].width);
+                groupHeights.push_back(images[i].height);
+            }
+            averageSize(groupWidths, groupHeights, array.width, array.height);
+            array.levels = 1;
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGB8, array.width, array.height, array.layers, 0, GL_BGR, GL_UNSIGNED_BYTE, NULL);
+            // level 0 only until every layer is in and the mips can be generated
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+            // RGB8 is stored as 4 bytes a texel by most drivers; the mip chain adds a third
+            bytes += static_cast<size_t>(array.width) * array.height * array.layers * 4 * 4 / 3;
+        }
+
+        // trilinear filtering over a full mip chain, and anisotropic where available
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        if (anisotropic) glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_ANISOTROPY_EXT, anisotropy);
+
+        for (int layer = 0; layer < array.layers; layer++) {
+            imageT& image = images[groups[g][layer]];
+            image.location.array = static_cast<int>(g);
+            image.location.layer = layer;
+            decodeOrder.push_back(groups[g][layer]);
+        }
+        arrays.push_back(array);
+        std::cout << "Texture array " << g << ": " << array.layers << " layers of " << array.width << "x" << array.height
+                  << (array.fourCC == FOURCC_BC1 ? " BC1" : array.fourCC == FOURCC_BC3 ? " BC3" : "") << std::endl;
+    }
+    std::cout << images.size() << " textures (" << compressedImages << " compressed) in " << arrays.size()
+              << " arrays, about " << bytes / (1024 * 1024) << " MB with mipmaps" << std::endl;
+
+    // one layer fits in each pixel buffer of the ring
+    for (int i : decodeOrder) bufferSize = std::max(bufferSize, uploadSize(images[i]));
+    if (!decodeOrder.empty()) {
+        pixelBuffers.resize(TEXTURE_PIXEL_BUFFERS);
+        pixelFences.assign(TEXTURE_PIXEL_BUFFERS, 0);
+        glGenBuffers(TEXTURE_PIXEL_BUFFERS, pixelBuffers.data());
+        for (GLuint buffer : pixelBuffers) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, bufferSize, NULL, GL_STREAM_DRAW);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    pending = static_cast<int>(decodeOrder.size());
+    nextDecode = 0;
+    stopping = false;
+    unsigned int workerCount = std::min(MAX_TEXTURE_WORKERS, std::max(1u, std::thread::hardware_concurrency()));
+    workerCount = std::min(workerCount, static_cast<unsigned int>(decodeOrder.size()));
+    for (unsigned int w = 0; w < workerCount; w++) workers.emplace_back(&TextureArraySet::decode, this);
+    return !arrays.empty();
+}
+
+// Worker thread: read the next image and bring it to its layer's size. Only the image's
+// pixels are written; empty pixels tell update the image could not be read.
+void TextureArraySet::decode() {
+    while (!stopping) {
+        size_t next = nextDecode++;
+        if (next >= decodeOrder.size()) return;
+        int index = decodeOrder[next];
+        const imageT& image = images[index];
+        const arrayT& array = arrays[image.location.array];
+
+        std::vector<unsigned char> pixels;
+        unsigned int width = 0, height = 0, fourCC = 0, levels = 0;
+        bool valid;
+        if (image.fourCC != 0) {
+            valid = readDDS(ddsPathFor(image.path).c_str(), pixels, width, height, fourCC, levels) &&
+                    width == image.width && height == image.height && fourCC == image.fourCC && levels >= array.levels;
+        } else {
+            valid = readBMP(image.path.c_str(), pixels, width, height) && width == image.width && height == image.height;
+            if (valid && (width != array.width || height != array.height)) {
+                pixels = resampleBGR(pixels, width, height, array.width, array.height);
+            }
+        }
+        if (!valid) pixels.clear();
+
+        std::lock_guard<std::mutex> lock(decodedMutex);
+        images[index].pixels.swap(pixels);
+        decoded.push_back(index);
+    }
+}
+
+void TextureArraySet::stopWorkers() {
+    stopping = true;
+    for (std::thread& worker : workers) worker.join();
+    workers.clear();
+}
+
+// Bytes of one layer as uploaded, the whole mip chain for compressed arrays
+size_t TextureArraySet::uploadSize(const imageT& image) const {
+    const arrayT& array = arrays[image.location.array];
+    if (array.fourCC == 0) return bgrRowStride(array.width) * array.height;
+    size_t size = 0;
+    for (unsigned int l = 0; l < array.levels; l++) {
+        size += compressedLevelSize(std::max(1u, array.width >> l), std::max(1u, array.height >> l), array.fourCC);
+    }
+    return size;
+}
+
+// Copy a decoded layer into the next pixel buffer of the ring and upload it from there
+// Returns false when that buffer is still being read by the GPU
+bool TextureArraySet::upload(int index) {
+    GLsync& fence = pixelFences[nextBuffer];
+    if (fence) {
+        GLenum state = glClientWaitSync(fence, 0, 0);
+        if (state == GL_TIMEOUT_EXPIRED || state == GL_WAIT_FAILED) return false;
+        glDeleteSync(fence);
+        fence = 0;
+    }
+
+    imageT& image = images[index];
+    arrayT& array = arrays[image.location.array];
+    size_t size = uploadSize(image);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers[nextBuffer]);
+    void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped) {
+        memcpy(mapped, image.pixels.data(), size);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    } else {
+        glBufferSubData(GL_PIXEL_UNPACK_BUFFER, 0, size, image.pixels.data());
+    }
+
+    // on the array's own unit, the bindings stay as bind left them
+    glActiveTexture(GL_TEXTURE0 + firstUnit + image.location.array);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, array.texture);
+    if (array.fourCC != 0) {
+        size_t offset = 0;
+        for (unsigned int l = 0; l < array.levels; l++) {
+            unsigned int levelWidth = std::max(1u, array.width >> l);
+            unsigned int levelHeight = std::max(1u, array.height >> l);
+            size_t levelSize = compressedLevelSize(levelWidth, levelHeight, array.fourCC);
+            glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, l, 0, 0, image.location.layer, levelWidth, levelHeight, 1,
+                                      compressedFormat(array.fourCC), static_cast<GLsizei>(levelSize),
+                                      reinterpret_cast<const void*>(offset));
+            offset += levelSize;
+        }
+    } else {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, image.location.layer, array.width, array.height, 1,
+                        GL_BGR, GL_UNSIGNED_BYTE, NULL);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    nextBuffer = (nextBuffer + 1) % pixelBuffers.size();
+
+    // the GL has its copy
+    std::vector<unsigned char>().swap(image.pixels);
+    image.resident = true;
+    array.uploaded++;
+    finishLayer(image.location.array);
+    return true;
+}
+
+// A layer is done with, uploaded or failed; once the last one is, a BMP array gets the mips
+// of the layers that made it in
+void TextureArraySet::finishLayer(int index) {
+    arrayT& array = arrays[index];
+    array.finished++;
+    if (array.fourCC == 0 && array.finished == array.layers && array.uploaded > 0) {
+        glActiveTexture(GL_TEXTURE0 + firstUnit + index);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, array.texture);
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 1000);
+    }
+}
+
+bool TextureArraySet::update() {
+    if (pending == 0) return false;
+    {
+        std::lock_guard<std::mutex> lock(decodedMutex);
+        uploadQueue.insert(uploadQueue.end(), decoded.begin(), decoded.end());
+        decoded.clear();
+    }
+
+    bool changed = false;
+    size_t uploaded = 0;
+    while (!uploadQueue.empty() && uploaded < TEXTURE_UPLOAD_BUDGET) {
+        int index = uploadQueue.front();
+        if (images[index].pixels.empty()) {
+            std::cout << "Texture " << images[index].path << " could not be read" << std::endl;
+            finishLayer(images[index].location.array);
+        } else if (upload(index)) {
+            uploaded += uploadSize(images[index]);
+            changed = true;
+        } else {
+            break;
+        }
+        uploadQueue.pop_front();
+        pending--;
+    }
+
+    if (pending == 0) {
+        // all in: the workers are done and the ring is no longer needed
+        stopWorkers();
+        for (GLsync fence : pixelFences) {
+            if (fence) glDeleteSync(fence);
+        }
+        pixelFences.clear();
+        glDeleteBuffers(static_cast<GLsizei>(pixelBuffers.size()), pixelBuffers.data());
+        pixelBuffers.clear();
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - streamStart);
+        std::cout << "Textures streamed in " << elapsed.count() << " ms" << std::endl;
+    }
+    return changed;
+}
+
+void TextureArraySet::bind(GLuint unit) {
+    firstUnit = unit;
+    for (size_t a = 0; a < arrays.size(); a++) {
+        glActiveTexture(GL_TEXTURE0 + firstUnit + static_cast<GLuint>(a));
+        glBindTexture(GL_TEXTURE_2D_ARRAY, arrays[a].texture);
+    }
+}
+
+void TextureArraySet::destroy() {
+    stopWorkers();
+    for (GLsync fence : pixelFences) {
+        if (fence) glDeleteSync(fence);
+    }
+    pixelFences.clear();
+    if (!pixelBuffers.empty()) glDeleteBuffers(static_cast<GLsizei>(pixelBuffers.size()), pixelBuffers.data());
+    pixelBuffers.clear();
+    for (const arrayT& array : arrays) glDeleteTextures(1, &array.texture);
+    arrays.clear();
+    images.clear();
+    decodeOrder.clear();
+    decoded.clear();
+    uploadQueue.clear();
+    pending = 0;
+}
+
+textureLocationT TextureArraySet::getLocation(int image) const {
+    if (image < 0 || image >= static_cast<int>(images.size())) {
+        textureLocationT none = { 0, 0 };
+        return none;
+    }
+    if (!images[image].resident) {
+        textureLocationT placeholder = { -1, 0 };
+        return placeholder;
+    }
+    return images[image].location;
+}
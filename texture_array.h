@@ -0,0 +1,124 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: The scene's textures packed into a few GL_TEXTURE_2D_ARRAY textures with full
+mip chains. Images of similar size share an array and are resampled to its layer size, so
+all twelve wood textures of the piece set are one array bound once; an instance selects
+its texture by array and layer. Textures converted by bmp_to_dds are uploaded as BC1/BC3
+with their precomputed mips. Only the file headers are read before the first frame: worker
+threads decode the images and the render loop uploads them through a ring of pixel buffer
+objects a few layers a frame, drawing a placeholder colour until a layer is resident.
+*/
+
+#ifndef TEXTURE_ARRAY_H
+#define TEXTURE_ARRAY_H
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <GL/glew.h>
+#include "chessCommon.h"
+
+// Where an image ended up
+typedef struct
+{
+    int array;      // sampler in the shader's textureArrays, -1 until the image is streamed in
+    int layer;
+} textureLocationT;
+
+class TextureArraySet {
+private:
+    typedef struct
+    {
+        std::string path;
+        std::vector<unsigned char> pixels;  // BGR rows padded to 4 bytes at the layer size, or the compressed
+                                            // mip chain; written by a worker, freed once uploaded
+        unsigned int width, height;         // as stored in the file
+        unsigned int fourCC;                // FOURCC_BC1 or FOURCC_BC3 when read from the DDS, 0 for the BMP
+        unsigned int levels;
+        textureLocationT location;
+        bool resident;                      // uploaded, instances may sample it
+    } imageT;
+
+    typedef struct
+    {
+        GLuint texture;
+        unsigned int width, height;
+        unsigned int fourCC;
+        unsigned int levels;
+        int layers;
+        int uploaded;
+        int finished;                       // layers uploaded or given up on
+    } arrayT;
+
+    std::vector<imageT> images;
+    std::vector<arrayT> arrays;
+    GLuint firstUnit;
+
+    // decoding: workers take the images in upload order and hand them back through decoded
+    std::vector<std::thread> workers;
+    std::vector<int> decodeOrder;
+    std::atomic<size_t> nextDecode;
+    std::atomic<bool> stopping;
+    std::mutex decodedMutex;
+    std::vector<int> decoded;
+
+    // uploading: decoded images wait in uploadQueue for a free pixel buffer of the ring
+    std::deque<int> uploadQueue;
+    std::vector<GLuint> pixelBuffers;
+    std::vector<GLsync> pixelFences;
+    unsigned int nextBuffer;
+    size_t bufferSize;
+    int pending;                        // images neither resident nor failed
+    std::chrono::steady_clock::time_point streamStart;
+
+    void decode();
+    size_t uploadSize(const imageT& image) const;
+    bool upload(int image);
+    void finishLayer(int array);
+    void stopWorkers();
+
+public:
+    TextureArraySet();
+    ~TextureArraySet();
+
+    /**
+     * register an image to be packed by build, reading only its header; the DDS bmp_to_dds
+     * made of it is used instead when present and S3TC is supported
+     * @param path BMP file
+     * @return image id, -1 if it could not be read
+     */
+    int addImage(const std::string& path);
+
+    /**
+     * group the images into arrays and allocate them, then start decoding on worker threads;
+     * the pixels arrive through update over the following frames
+     * @return true if at least one array was created
+     */
+    bool build();
+
+    /**
+     * upload what the workers have decoded, a few layers a frame through the pixel buffer ring
+     * @return true if an image became resident and its location changed
+     */
+    bool update();
+    bool isStreaming() const { return pending > 0; }
+
+    /**
+     * bind every array, array i to unit firstUnit + i
+     * @param firstUnit first texture unit
+     */
+    void bind(GLuint firstUnit);
+    void destroy();
+
+    unsigned int arrayCount() const { return static_cast<unsigned int>(arrays.size()); }
+    // array and layer of an image; layer 0 of array 0 for -1, array -1 until it is resident
+    textureLocationT getLocation(int image) const;
+};
+
+#endif
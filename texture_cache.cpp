@@ -0,0 +1,97 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Implementation of the texture cache
+*/
+
+#include "texture_cache.h"
+#include <iostream>
+#include <regex>
+
+TextureCache::TextureCache() : liveRefs(0), requests(0) {
+}
+
+std::string TextureCache::resolvePath(const std::string& name) {
+    // Any combination of 0-9, space in the beginning or end is allowed;
+    // compiled once for every texture of the run
+    static const std::regex regexRule("\\s*([\\w0-9]+)\\.\\s*");
+    std::smatch matches;
+    if (!std::regex_search(name, matches, regexRule)) {
+        return std::string();
+    }
+
+    // Only BMPs are supported; the board and the pieces each have their own directory
+    std::string file = matches[1].str();
+    if (file == "12951_Stone_Chess_Board_diff") {
+        return "Lab3/Stone_Chess_Board/" + file + ".bmp";
+    }
+    return "Lab3/Chess/" + file + ".bmp";
+}
+
+int TextureCache::acquire(const std::string& name) {
+    requests++;
+    auto known = resolved.find(name);
+    if (known == resolved.end()) {
+        known = resolved.emplace(name, resolvePath(name)).first;
+    }
+    const std::string& path = known->second;
+    if (path.empty()) {
+        return -1;
+    }
+
+    auto cached = byPath.find(path);
+    int handle;
+    if (cached != byPath.end()) {
+        handle = cached->second;
+    } else {
+        // first use of this file
+        entryT entry;
+        entry.path = path;
+        entry.image = textures.addImage(path);
+        entry.refs = 0;
+        entries.push_back(entry);
+        handle = static_cast<int>(entries.size()) - 1;
+        byPath[path] = handle;
+    }
+    entries[handle].refs++;
+    liveRefs++;
+    return handle;
+}
+
+void TextureCache::release(int handle) {
+    if (handle < 0 || handle >= static_cast<int>(entries.size()) || entries[handle].refs == 0) {
+        return;
+    }
+    entries[handle].refs--;
+    liveRefs--;
+    if (liveRefs == 0) {
+        // the entries' image ids die with the arrays, a later acquire starts over
+        destroy();
+    }
+}
+
+bool TextureCache::build() {
+    unsigned int loaded = 0;
+    for (const entryT& entry : entries) {
+        if (entry.image >= 0) loaded++;
+    }
+    std::cout << requests << " texture requests, " << loaded << " of " << entries.size() << " files read" << std::endl;
+    return textures.build();
+}
+
+void TextureCache::destroy() {
+    textures.destroy();
+    entries.clear();
+    byPath.clear();
+    resolved.clear();
+    liveRefs = 0;
+    requests = 0;
+}
+
+textureLocationT TextureCache::getLocation(int handle) const {
+    if (handle < 0 || handle >= static_cast<int>(entries.size())) {
+        return textures.getLocation(-1);
+    }
+    return textures.getLocation(entries[handle].image);
+}
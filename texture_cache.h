@@ -0,0 +1,71 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Reference-counted cache in front of the scene's texture arrays. Material texture
+names are resolved to BMP paths once, every distinct file is read once however many meshes
+use it, and components hold a shared handle they release through the cache. The GL arrays
+go once the last handle is released, single layers cannot be freed on their own.
+*/
+
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "texture_array.h"
+
+class TextureCache {
+private:
+    typedef struct
+    {
+        std::string path;
+        int image;          // id in the texture arrays, -1 if it could not be read
+        int refs;
+    } entryT;
+
+    TextureArraySet textures;
+    std::vector<entryT> entries;
+    std::unordered_map<std::string, int> byPath;        // resolved path -> entry
+    std::unordered_map<std::string, std::string> resolved;  // material name -> path
+    int liveRefs;
+    int requests;
+
+public:
+    TextureCache();
+
+    /**
+     * turn a material's texture name into the BMP the game ships
+     * @param name texture name from the material, e.g. "wooddark3.jpg"
+     * @return path of the BMP, empty if the name has no recognisable file name
+     */
+    static std::string resolvePath(const std::string& name);
+
+    /**
+     * get a shared handle to a texture, registering the file with the arrays on first use
+     * @param name texture name from the material
+     * @return handle, -1 if the name cannot be resolved
+     */
+    int acquire(const std::string& name);
+
+    /**
+     * give a handle back; once nothing holds a handle the arrays are deleted and the cache
+     * is emptied, so textures acquired after that are registered and built again
+     * @param handle handle from acquire, -1 is ignored
+     */
+    void release(int handle);
+
+    // allocate the arrays for everything acquired so far and start streaming it in
+    bool build();
+    // upload the next decoded textures; true if a handle's location changed
+    bool update() { return textures.update(); }
+    bool isStreaming() const { return textures.isStreaming(); }
+    void bind(GLuint firstUnit) { textures.bind(firstUnit); }
+    void destroy();
+
+    textureLocationT getLocation(int handle) const;
+    unsigned int uniqueCount() const { return static_cast<unsigned int>(entries.size()); }
+};
+
+#endif
@@ -0,0 +1,375 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Implementation of the texture grouping, resampling and BC1/BC3 compression
+*/
+
+#include "texture_compress.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+std::vector<std::vector<int>> groupBySize(const std::vector<unsigned int>& widths,
+                                          const std::vector<unsigned int>& heights, int maxGroups) {
+    std::vector<std::vector<int>> groups;
+    for (size_t i = 0; i < widths.size(); i++) {
+        int best = -1;
+        float bestDistance = 0.0f;
+        for (size_t g = 0; g < groups.size(); g++) {
+            int first = groups[g].front();
+            float rw = static_cast<float>(widths[i]) / widths[first];
+            float rh = static_cast<float>(heights[i]) / heights[first];
+            bool close = rw <= ARRAY_SIZE_TOLERANCE && rw >= 1.0f / ARRAY_SIZE_TOLERANCE &&
+                         rh <= ARRAY_SIZE_TOLERANCE && rh >= 1.0f / ARRAY_SIZE_TOLERANCE;
+            float distance = std::fabs(std::log(rw)) + std::fabs(std::log(rh));
+            // out of groups: take the nearest regardless
+            if ((close || static_cast<int>(groups.size()) >= maxGroups) && (best < 0 || distance < bestDistance)) {
+                best = static_cast<int>(g);
+                bestDistance = distance;
+            }
+            if (close) break;
+        }
+        if (best < 0) {
+            groups.push_back(std::vector<int>());
+            best = static_cast<int>(groups.size()) - 1;
+        }
+        groups[best].push_back(static_cast<int>(i));
+    }
+    return groups;
+}
+
+void averageSize(const std::vector<unsigned int>& widths, const std::vector<unsigned int>& heights,
+                 unsigned int& width, unsigned int& height) {
+    double sumWidth = 0.0, sumHeight = 0.0;
+    for (size_t i = 0; i < widths.size(); i++) {
+        sumWidth += widths[i];
+        sumHeight += heights[i];
+    }
+    width = static_cast<unsigned int>(std::lround(sumWidth / widths.size()));
+    height = static_cast<unsigned int>(std::lround(sumHeight / heights.size()));
+}
+
+size_t bgrRowStride(unsigned int width) {
+    return (static_cast<size_t>(width) * 3 + 3) & ~static_cast<size_t>(3);
+}
+
+// Resample one line of BGR pixels: averages the covered source pixels when shrinking,
+// interpolates between the two nearest when growing
+static void resampleLine(const unsigned char* src, unsigned int srcCount, size_t srcStep,
+                         unsigned char* dst, unsigned int dstCount, size_t dstStep) {
+    float ratio = static_cast<float>(srcCount) / dstCount;
+    for (unsigned int i = 0; i < dstCount; i++) {
+        float sum[3] = { 0.0f, 0.0f, 0.0f };
+        if (ratio > 1.0f) {
+            float begin = i * ratio;
+            float end = begin + ratio;
+            float weightSum = 0.0f;
+            for (unsigned int s = static_cast<unsigned int>(begin); s < srcCount && s < end; s++) {
+                float weight = std::min(end, s + 1.0f) - std::max(begin, static_cast<float>(s));
+                for (int c = 0; c < 3; c++) sum[c] += weight * src[s * srcStep + c];
+                weightSum += weight;
+            }
+            for (int c = 0; c < 3; c++) sum[c] /= weightSum;
+        } else {
+            float position = std::max(0.0f, (i + 0.5f) * ratio - 0.5f);
+            unsigned int s0 = std::min(static_cast<unsigned int>(position), srcCount - 1);
+            unsigned int s1 = std::min(s0 + 1, srcCount - 1);
+            float t = position - s0;
+            for (int c = 0; c < 3; c++) sum[c] = (1.0f - t) * src[s0 * srcStep + c] + t * src[s1 * srcStep + c];
+        }
+        for (int c = 0; c < 3; c++) dst[i * dstStep + c] = static_cast<unsigned char>(std::lround(std::min(255.0f, sum[c])));
+    }
+}
+
+std::vector<unsigned char> resampleBGR(const std::vector<unsigned char>& src, unsigned int srcWidth,
+                                       unsigned int srcHeight, unsigned int width, unsigned int height) {
+    // rows first and then columns
+    std::vector<unsigned char> rows(bgrRowStride(width) * srcHeight);
+    for (unsigned int y = 0; y < srcHeight; y++) {
+        resampleLine(&src[y * bgrRowStride(srcWidth)], srcWidth, 3, &rows[y * bgrRowStride(width)], width, 3);
+    }
+    std::vector<unsigned char> out(bgrRowStride(width) * height);
+    for (unsigned int x = 0; x < width; x++) {
+        resampleLine(&rows[x * 3], srcHeight, bgrRowStride(width), &out[x * 3], height, bgrRowStride(width));
+    }
+    return out;
+}
+
+size_t compressedLevelSize(unsigned int width, unsigned int height, unsigned int fourCC) {
+    size_t blockSize = fourCC == FOURCC_BC1 ? 8 : 16;
+    return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+}
+
+// 5:6:5 endpoint and the colour it decodes to
+static uint16_t packColor(const float color[3]) {
+    int r = static_cast<int>(std::lround(std::min(255.0f, std::max(0.0f, color[0])) * 31.0f / 255.0f));
+    int g = static_cast<int>(std::lround(std::min(255.0f, std::max(0.0f, color[1])) * 63.0f / 255.0f));
+    int b = static_cast<int>(std::lround(std::min(255.0f, std::max(0.0f, color[2])) * 31.0f / 255.0f));
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static void unpackColor(uint16_t packed, float color[3]) {
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = static_cast<float>((r << 3) | (r >> 2));
+    color[1] = static_cast<float>((g << 2) | (g >> 4));
+    color[2] = static_cast<float>((b << 3) | (b >> 2));
+}
+
+// Pick the nearest of the four palette entries for each texel; returns the squared error
+static float fitIndices(const float texels[16][3], uint16_t c0, uint16_t c1, uint32_t& indices) {
+    float palette[4][3];
+    unpackColor(c0, palette[0]);
+    unpackColor(c1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+        palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+    }
+    indices = 0;
+    float error = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        int best = 0;
+        float bestDistance = 0.0f;
+        for (int p = 0; p < 4; p++) {
+            float distance = 0.0f;
+            for (int c = 0; c < 3; c++) {
+                float d = texels[i][c] - palette[p][c];
+                distance += d * d;
+            }
+            if (p == 0 || distance < bestDistance) {
+                best = p;
+                bestDistance = distance;
+            }
+        }
+        indices |= static_cast<uint32_t>(best) << (2 * i);
+        error += bestDistance;
+    }
+    return error;
+}
+
+// Endpoints in four colour mode: colour 0 must sort above colour 1
+static void orderEndpoints(uint16_t& c0, uint16_t& c1) {
+    if (c0 < c1) std::swap(c0, c1);
+}
+
+// Colour block: endpoints at the extremes of the principal axis, then one least squares
+// refinement of the endpoints for the chosen indices
+static void encodeColorBlock(const float texels[16][3], unsigned char* out) {
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; i++) for (int c = 0; c < 3; c++) mean[c] += texels[i][c] / 16.0f;
+    float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; i++) {
+        float d[3] = { texels[i][0] - mean[0], texels[i][1] - mean[1], texels[i][2] - mean[2] };
+        covariance[0] += d[0] * d[0];
+        covariance[1] += d[0] * d[1];
+        covariance[2] += d[0] * d[2];
+        covariance[3] += d[1] * d[1];
+        covariance[4] += d[1] * d[2];
+        covariance[5] += d[2] * d[2];
+    }
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float next[3] = {
+            covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+            covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+            covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2]
+        };
+        float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+        if (length <= 0.0f) break;
+        for (int c = 0; c < 3; c++) axis[c] = next[c] / length;
+    }
+    float low = 0.0f, high = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        float t = 0.0f;
+        for (int c = 0; c < 3; c++) t += (texels[i][c] - mean[c]) * axis[c];
+        if (i == 0 || t < low) low = t;
+        if (i == 0 || t > high) high = t;
+    }
+    float end0[3], end1[3];
+    for (int c = 0; c < 3; c++) {
+        end0[c] = mean[c] + high * axis[c];
+        end1[c] = mean[c] + low * axis[c];
+    }
+    uint16_t c0 = packColor(end0), c1 = packColor(end1);
+    orderEndpoints(c0, c1);
+    uint32_t indices = 0;
+    float error = c0 == c1 ? 0.0f : fitIndices(texels, c0, c1, indices);
+
+    if (c0 != c1) {
+        // each texel is w * colour 0 + (1 - w) * colour 1, solve for the two colours
+        const float WEIGHT[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        float ax[3] = { 0.0f, 0.0f, 0.0f }, bx[3] = { 0.0f, 0.0f, 0.0f };
+        for (int i = 0; i < 16; i++) {
+            float w = WEIGHT[(indices >> (2 * i)) & 3];
+            aa += w * w;
+            ab += w * (1.0f - w);
+            bb += (1.0f - w) * (1.0f - w);
+            for (int c = 0; c < 3; c++) {
+                ax[c] += w * texels[i][c];
+                bx[c] += (1.0f - w) * texels[i][c];
+            }
+        }
+        float determinant = aa * bb - ab * ab;
+        if (std::fabs(determinant) > 1e-6f) {
+            for (int c = 0; c < 3; c++) {
+                end0[c] = (bb * ax[c] - ab * bx[c]) / determinant;
+                end1[c] = (aa * bx[c] - ab * ax[c]) / determinant;
+            }
+            uint16_t r0 = packColor(end0), r1 = packColor(end1);
+            orderEndpoints(r0, r1);
+            if (r0 != r1) {
+                uint32_t refined;
+                float refinedError = fitIndices(texels, r0, r1, refined);
+                if (refinedError < error) {
+                    c0 = r0;
+                    c1 = r1;
+                    indices = refined;
+                }
+            }
+        }
+    }
+
+    out[0] = static_cast<unsigned char>(c0 & 0xFF);
+    out[1] = static_cast<unsigned char>(c0 >> 8);
+    out[2] = static_cast<unsigned char>(c1 & 0xFF);
+    out[3] = static_cast<unsigned char>(c1 >> 8);
+    for (int b = 0; b < 4; b++) out[4 + b] = static_cast<unsigned char>((indices >> (8 * b)) & 0xFF);
+}
+
+// Alpha block: the two extremes and the six values between them
+static void encodeAlphaBlock(const float alpha[16], unsigned char* out) {
+    float low = *std::min_element(alpha, alpha + 16);
+    float high = *std::max_element(alpha, alpha + 16);
+    unsigned char a0 = static_cast<unsigned char>(std::lround(high));
+    unsigned char a1 = static_cast<unsigned char>(std::lround(low));
+    uint64_t indices = 0;
+    if (a0 != a1) {
+        float palette[8];
+        palette[0] = a0;
+        palette[1] = a1;
+        for (int p = 1; p < 7; p++) palette[p + 1] = ((7 - p) * a0 + p * a1) / 7.0f;
+        for (int i = 0; i < 16; i++) {
+            int best = 0;
+            for (int p = 1; p < 8; p++) {
+                if (std::fabs(alpha[i] - palette[p]) < std::fabs(alpha[i] - palette[best])) best = p;
+            }
+            indices |= static_cast<uint64_t>(best) << (3 * i);
+        }
+    }
+    out[0] = a0;
+    out[1] = a1;
+    for (int b = 0; b < 6; b++) out[2 + b] = static_cast<unsigned char>((indices >> (8 * b)) & 0xFF);
+}
+
+// One mip level, RGBA with tight rows, into blocks; edge blocks repeat the last row and column
+static std::vector<unsigned char> compressLevel(const std::vector<unsigned char>& rgba, unsigned int width,
+                                                unsigned int height, unsigned int fourCC) {
+    std::vector<unsigned char> out(compressedLevelSize(width, height, fourCC));
+    size_t blockSize = fourCC == FOURCC_BC1 ? 8 : 16;
+    unsigned char* block = out.data();
+    for (unsigned int by = 0; by < height; by += 4) {
+        for (unsigned int bx = 0; bx < width; bx += 4) {
+            float texels[16][3];
+            float alpha[16];
+            for (int i = 0; i < 16; i++) {
+                unsigned int x = std::min(bx + i % 4, width - 1);
+                unsigned int y = std::min(by + i / 4, height - 1);
+                const unsigned char* p = &rgba[(static_cast<size_t>(y) * width + x) * 4];
+                for (int c = 0; c < 3; c++) texels[i][c] = p[c];
+                alpha[i] = p[3];
+            }
+            if (fourCC == FOURCC_BC3) {
+                encodeAlphaBlock(alpha, block);
+                encodeColorBlock(texels, block + 8);
+            } else {
+                encodeColorBlock(texels, block);
+            }
+            block += blockSize;
+        }
+    }
+    return out;
+}
+
+compressedImageT compressImage(const std::vector<unsigned char>& bgr, unsigned int width,
+                               unsigned int height, unsigned int fourCC) {
+    compressedImageT image;
+    image.width = width;
+    image.height = height;
+    image.fourCC = fourCC;
+
+    // RGBA with tight rows; the BMPs have no alpha
+    std::vector<unsigned char> level(static_cast<size_t>(width) * height * 4);
+    for (unsigned int y = 0; y < height; y++) {
+        for (unsigned int x = 0; x < width; x++) {
+            const unsigned char* p = &bgr[y * bgrRowStride(width) + x * 3];
+            unsigned char* q = &level[(static_cast<size_t>(y) * width + x) * 4];
+            q[0] = p[2];
+            q[1] = p[1];
+            q[2] = p[0];
+            q[3] = 255;
+        }
+    }
+
+    while (true) {
+        image.levels.push_back(compressLevel(level, width, height, fourCC));
+        if (width == 1 && height == 1) break;
+
+        // 2x2 box filter, an odd last row or column is averaged with itself
+        unsigned int nextWidth = std::max(1u, width / 2);
+        unsigned int nextHeight = std::max(1u, height / 2);
+        std::vector<unsigned char> next(static_cast<size_t>(nextWidth) * nextHeight * 4);
+        for (unsigned int y = 0; y < nextHeight; y++) {
+            unsigned int y0 = std::min(2 * y, height - 1), y1 = std::min(2 * y + 1, height - 1);
+            for (unsigned int x = 0; x < nextWidth; x++) {
+                unsigned int x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+                for (int c = 0; c < 4; c++) {
+                    unsigned int sum = level[(static_cast<size_t>(y0) * width + x0) * 4 + c] +
+                                       level[(static_cast<size_t>(y0) * width + x1) * 4 + c] +
+                                       level[(static_cast<size_t>(y1) * width + x0) * 4 + c] +
+                                       level[(static_cast<size_t>(y1) * width + x1) * 4 + c];
+                    next[(static_cast<size_t>(y) * nextWidth + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+                }
+            }
+        }
+        level.swap(next);
+        width = nextWidth;
+        height = nextHeight;
+    }
+    return image;
+}
+
+static void putUint32(unsigned char* header, size_t offset, uint32_t value) {
+    for (int b = 0; b < 4; b++) header[offset + b] = static_cast<unsigned char>((value >> (8 * b)) & 0xFF);
+}
+
+bool writeDDS(const std::string& path, const compressedImageT& image) {
+    // DDSD_CAPS | HEIGHT | WIDTH | PIXELFORMAT | MIPMAPCOUNT | LINEARSIZE
+    const uint32_t FLAGS = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;
+    // DDSCAPS_COMPLEX | TEXTURE | MIPMAP
+    const uint32_t CAPS = 0x8 | 0x1000 | 0x400000;
+    const uint32_t DDPF_FOURCC = 0x4;
+
+    unsigned char header[124];
+    memset(header, 0, sizeof(header));
+    putUint32(header, 0, 124);
+    putUint32(header, 4, FLAGS);
+    putUint32(header, 8, image.height);
+    putUint32(header, 12, image.width);
+    putUint32(header, 16, static_cast<uint32_t>(compressedLevelSize(image.width, image.height, image.fourCC)));
+    putUint32(header, 24, static_cast<uint32_t>(image.levels.size()));
+    putUint32(header, 72, 32);
+    putUint32(header, 76, DDPF_FOURCC);
+    putUint32(header, 80, image.fourCC);
+    putUint32(header, 104, CAPS);
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+    bool written = fwrite("DDS ", 1, 4, file) == 4 && fwrite(header, 1, sizeof(header), file) == sizeof(header);
+    for (const std::vector<unsigned char>& level : image.levels) {
+        written = written && fwrite(level.data(), 1, level.size(), file) == level.size();
+    }
+    return fclose(file) == 0 && written;
+}
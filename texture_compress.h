@@ -0,0 +1,85 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: CPU side of the texture pipeline, shared by the game and the bmp_to_dds tool:
+grouping images by size into texture arrays, resampling, and BC1/BC3 (DXT1/DXT5)
+compression of a full mip chain written out as DDS. Pixels keep the BMP row order, bottom
+row first, so compressed and uncompressed textures use the same UVs.
+*/
+
+#ifndef TEXTURE_COMPRESS_H
+#define TEXTURE_COMPRESS_H
+
+#include <string>
+#include <vector>
+
+// DDS pixel formats, as the four characters of the file's fourCC
+const unsigned int FOURCC_BC1 = 0x31545844;    // "DXT1"
+const unsigned int FOURCC_BC3 = 0x35545844;    // "DXT5"
+
+// Images group into an array with a first image within this factor in both dimensions
+const float ARRAY_SIZE_TOLERANCE = 2.0f;
+
+// A compressed image with its mip chain, level 0 first
+typedef struct
+{
+    unsigned int width, height;
+    unsigned int fourCC;
+    std::vector<std::vector<unsigned char>> levels;
+} compressedImageT;
+
+/**
+ * group images of similar size: an image joins the first group whose first image is within
+ * ARRAY_SIZE_TOLERANCE, or starts one; once maxGroups exist it joins the nearest instead
+ * @param widths image widths
+ * @param heights image heights
+ * @param maxGroups most groups to create
+ * @return image indices of each group
+ */
+std::vector<std::vector<int>> groupBySize(const std::vector<unsigned int>& widths,
+                                          const std::vector<unsigned int>& heights, int maxGroups);
+
+/**
+ * layer size of an array, the average size of its images
+ * @param widths widths of the array's images
+ * @param heights heights of the array's images
+ * @param width, height layer size
+ */
+void averageSize(const std::vector<unsigned int>& widths, const std::vector<unsigned int>& heights,
+                 unsigned int& width, unsigned int& height);
+
+// bytes per BGR row, padded to 4 as in a BMP
+size_t bgrRowStride(unsigned int width);
+
+/**
+ * resample a BGR image with rows padded to 4: box filter when shrinking, linear when growing
+ * @return the resampled image, rows padded to 4
+ */
+std::vector<unsigned char> resampleBGR(const std::vector<unsigned char>& src, unsigned int srcWidth,
+                                       unsigned int srcHeight, unsigned int width, unsigned int height);
+
+/**
+ * bytes of one compressed mip level
+ * @param width, height level size in texels
+ * @param fourCC FOURCC_BC1 or FOURCC_BC3
+ */
+size_t compressedLevelSize(unsigned int width, unsigned int height, unsigned int fourCC);
+
+/**
+ * box filter a mip chain down to 1x1 and compress every level
+ * @param bgr BGR image, rows padded to 4
+ * @param width, height image size
+ * @param fourCC FOURCC_BC1, or FOURCC_BC3 for an opaque alpha block
+ * @return the compressed chain
+ */
+compressedImageT compressImage(const std::vector<unsigned char>& bgr, unsigned int width,
+                               unsigned int height, unsigned int fourCC);
+
+/**
+ * write a compressed image as a DDS file that loadDDS and readDDS understand
+ * @return true if the whole file was written
+ */
+bool writeDDS(const std::string& path, const compressedImageT& image);
+
+#endif
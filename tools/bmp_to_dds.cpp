@@ -0,0 +1,92 @@
+/*
+Author: Leandro Alan Kim
+Class: ECE4122/6122
+Last Date Modified: Dec 6 2024
+Description: Offline texture converter. Groups the BMPs the way the game packs them into
+texture arrays, resamples each to its array's layer size and writes a BC1 (or BC3) DDS with
+a full mip chain next to it, which the game then loads instead of the BMP. Pass all of the
+scene's textures in one run so the images sharing an array come out the same size.
+usage: bmp_to_dds [-bc3] file.bmp...
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+#include <common/texture.hpp>
+#include "../chessCommon.h"
+#include "../texture_compress.h"
+
+int main(int argc, char* argv[]) {
+    unsigned int fourCC = FOURCC_BC1;
+    std::vector<std::string> paths;
+    for (int a = 1; a < argc; a++) {
+        std::string arg = argv[a];
+        if (arg == "-bc3") {
+            fourCC = FOURCC_BC3;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.empty()) {
+        std::cout << "usage: bmp_to_dds [-bc3] file.bmp..." << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> read;
+    std::vector<std::vector<unsigned char>> pixels;
+    std::vector<unsigned int> widths, heights;
+    for (const std::string& path : paths) {
+        std::vector<unsigned char> data;
+        unsigned int width, height;
+        if (!readBMP(path.c_str(), data, width, height) || width == 0 || height == 0) {
+            std::cout << path << " skipped" << std::endl;
+            continue;
+        }
+        read.push_back(path);
+        pixels.push_back(data);
+        widths.push_back(width);
+        heights.push_back(height);
+    }
+
+    size_t bmpBytes = 0, ddsBytes = 0;
+    int failed = 0;
+    std::vector<std::vector<int>> groups = groupBySize(widths, heights, MAX_TEXTURE_ARRAYS);
+    for (const std::vector<int>& group : groups) {
+        std::vector<unsigned int> groupWidths, groupHeights;
+        for (int i : group) {
+            groupWidths.push_back(widths[i]);
+            groupHeights.push_back(heights[i]);
+        }
+        unsigned int width, height;
+        averageSize(groupWidths, groupHeights, width, height);
+
+        for (int i : group) {
+            std::vector<unsigned char> layer = pixels[i];
+            if (widths[i] != width || heights[i] != height) {
+                layer = resampleBGR(pixels[i], widths[i], heights[i], width, height);
+            }
+            compressedImageT image = compressImage(layer, width, height, fourCC);
+
+            std::string::size_type dot = read[i].find_last_of('.');
+            std::string out = (dot == std::string::npos ? read[i] : read[i].substr(0, dot)) + ".dds";
+            if (!writeDDS(out, image)) {
+                std::cout << out << " could not be written" << std::endl;
+                failed++;
+                continue;
+            }
+            size_t bytes = 0;
+            for (const std::vector<unsigned char>& level : image.levels) bytes += level.size();
+            // what the GL holds for the BMP: 4 bytes a texel and a third more for the mips
+            bmpBytes += static_cast<size_t>(width) * height * 4 * 4 / 3;
+            ddsBytes += bytes;
+            std::cout << out << ": " << width << "x" << height << ", " << image.levels.size() << " levels, "
+                      << bytes / 1024 << " KB" << std::endl;
+        }
+    }
+    if (ddsBytes > 0) {
+        std::cout << "Texture memory " << bmpBytes / 1024 << " KB -> " << ddsBytes / 1024 << " KB ("
+                  << static_cast<float>(bmpBytes) / ddsBytes << "x smaller)" << std::endl;
+    }
+    return failed == 0 && read.size() == paths.size() ? 0 : 1;
+}